@@ -364,6 +364,44 @@ void process_cat_control(rx_settings & settings_to_apply, rx_status & status, rx
         } else {
             printf("?;");
         }
+    } else if (strncmp(cmd, "ZPF", 3) == 0) {
+#ifdef DSP_PROFILE
+        // DSP profile, one response per stage:
+        // ZPF<stage>,<ticks per ms>,<min>,<avg>,<max>,<histogram bin 0>/.../<bin 11>;
+        // histogram bin n counts blocks taking 2^(n+8) ticks or more, ZPF0; clears
+        s_dsp_profile &profile = receiver.rx_dsp_inst.profile;
+        if (cmd[3] == ';') {
+            const uint32_t ticks_per_ms = dsp_profile_ticks_per_ms();
+            for(uint8_t stage = 0; stage < dsp_num_stages; ++stage)
+            {
+              const uint32_t min = profile.blocks ? profile.min[stage] : 0;
+              printf("ZPF%s,%lu,%lu,%lu,%lu,", dsp_stage_names[stage], ticks_per_ms, min, profile.average(stage), profile.max[stage]);
+              for(uint8_t bin = 0; bin < dsp_profile_num_bins; ++bin)
+              {
+                printf(bin ? "/%lu" : "%lu", profile.histogram[stage][bin]);
+              }
+              printf(";");
+            }
+        } else if (cmd[3] == '0' && cmd[4] == ';') {
+            profile.request_reset();
+        } else {
+            printf("?;");
+        }
+#else
+        printf("?;");
+#endif
+    } else if (strncmp(cmd, "ZLD", 3) == 0) {
+        // DSP load: ZLD<load %>,<deadline misses>,<shed features>;
+        if (cmd[3] == ';') {
+            receiver.access(false);
+            const uint8_t dsp_load = status.dsp_load;
+            const uint32_t deadline_misses = status.deadline_misses;
+            const uint8_t shed_features = status.shed_features;
+            receiver.release();
+            printf("ZLD%u,%lu,%x;", dsp_load, deadline_misses, shed_features);
+        } else {
+            printf("?;");
+        }
     } else {
         // Unknown command
         printf("?;");
@@ -2,7 +2,18 @@
 #define __CIC_CORRECTIONS__
 #include <cstdint>
 
-extern const uint16_t cic_correction[];
-int16_t cic_correct(int16_t fft_bin, int16_t fft_offset, int16_t sample);
+//gain (x256) to flatten the CIC decimator response, for each bin of an
+//FFT of 2^fft_order points
+template<uint8_t fft_order>
+class cic_corrections
+{
+  static const uint16_t fft_size = 1u << fft_order;
+  uint16_t cic_correction[fft_size / 2u + 1u];
+
+  public:
+  cic_corrections();
+  uint16_t gain(int16_t fft_bin) const;
+  int16_t correct(int16_t fft_bin, int16_t fft_offset, int16_t sample) const;
+};
 
 #endif
@@ -0,0 +1,97 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: cic_decimator.cpp
+// description: block based CIC decimator for one channel of interleaved IQ
+// License: MIT
+//
+
+#include "cic_decimator.h"
+#include "pico/stdlib.h"
+
+static_assert(cic_order == 4, "cic_decimator is written for a 4th order filter");
+static_assert(cic_decimation_rate % 2 == 0, "decimation must consume whole I/Q pairs");
+static_assert(adc_block_size % cic_decimation_rate == 0, "block must hold whole output samples");
+
+cic_decimator :: cic_decimator()
+{
+  reset();
+}
+
+void cic_decimator :: reset()
+{
+  integrator1 = 0;
+  integrator2 = 0;
+  integrator3 = 0;
+  integrator4 = 0;
+  delay0 = 0;
+  delay1 = 0;
+  delay2 = 0;
+  delay3 = 0;
+}
+
+void __not_in_flash_func(cic_decimator :: process_block)(const uint16_t samples[], bool lagging, int16_t output[])
+{
+  //integrators use modulo 2^32 arithmetic, unsigned types make the wrap-around well defined
+  uint32_t i1 = integrator1;
+  uint32_t i2 = integrator2;
+  uint32_t i3 = integrator3;
+  uint32_t i4 = integrator4;
+
+  const uint16_t pairs_per_output = cic_decimation_rate/2u;
+  const uint16_t *sample = &samples[lagging ? 1 : 0];
+
+  for(uint16_t idx=0; idx<adc_block_size/cic_decimation_rate; idx++)
+  {
+    //implement integrator stages, two input slots at a time
+    if(lagging)
+    {
+      //zero followed by x
+      for(uint16_t pair=0; pair<pairs_per_output; pair++)
+      {
+        const uint32_t x = (int16_t)sample[0];
+        sample += 2;
+        i4 += 2*i3 + 3*i2 + 4*i1 + x;
+        i3 += 2*i2 + 3*i1 + x;
+        i2 += 2*i1 + x;
+        i1 += x;
+      }
+    }
+    else
+    {
+      //x followed by zero
+      for(uint16_t pair=0; pair<pairs_per_output; pair++)
+      {
+        const uint32_t x = (int16_t)sample[0];
+        sample += 2;
+        i1 += x;
+        i4 += 2*i3 + 3*i2 + 4*i1;
+        i3 += 2*i2 + 3*i1;
+        i2 += 2*i1;
+      }
+    }
+
+    //implement comb stages
+    const uint32_t comb1 = i4-delay0;
+    const uint32_t comb2 = comb1-delay1;
+    const uint32_t comb3 = comb2-delay2;
+    const uint32_t comb4 = comb3-delay3;
+    delay0 = i4;
+    delay1 = comb1;
+    delay2 = comb2;
+    delay3 = comb3;
+
+    //remove bit growth, but keep some extra bits since noise floor is now lower
+    output[2*idx] = (int32_t)comb4>>(cic_bit_growth-extra_bits);
+  }
+
+  integrator1 = i1;
+  integrator2 = i2;
+  integrator3 = i3;
+  integrator4 = i4;
+}
@@ -0,0 +1,50 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: cic_decimator.h
+// description: block based CIC decimator for one channel of interleaved IQ
+// License: MIT
+//
+
+#ifndef CIC_DECIMATOR_H
+#define CIC_DECIMATOR_H
+
+#include <stdint.h>
+#include "rx_definitions.h"
+
+//The ADC alternates between the I and Q inputs, so each channel is a stream
+//at 480kHz in which every other sample is zero. The channel that is sampled
+//first (leading) has its samples in the even slots, the other channel
+//(lagging) is half a sample later in the odd slots.
+//
+//Rather than clocking the integrators with the zeros, each pair of slots is
+//applied in a single update, this gives exactly the same result as the
+//sample by sample filter.
+class cic_decimator
+{
+  uint32_t integrator1;
+  uint32_t integrator2;
+  uint32_t integrator3;
+  uint32_t integrator4;
+  uint32_t delay0;
+  uint32_t delay1;
+  uint32_t delay2;
+  uint32_t delay3;
+
+  public:
+  cic_decimator();
+  void reset();
+
+  //samples  - interleaved ADC block of adc_block_size samples
+  //lagging  - process the odd (true) or even (false) slots
+  //output   - adc_block_size/cic_decimation_rate samples written with a
+  //           stride of 2, so that I and Q can share an interleaved buffer
+  void process_block(const uint16_t samples[], bool lagging, int16_t output[]);
+};
+
+#endif
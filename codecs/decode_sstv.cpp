@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <cmath>
 #include "decode_sstv.h"
-#include "cordic.h"
+#include "../cordic.h"
 
 //from the sample number work out the colour and x/y coordinates
 void c_sstv_decoder :: sample_to_pixel(uint16_t &x, uint16_t &y, uint8_t &colour, int32_t image_sample)
@@ -282,18 +282,17 @@ c_sstv_decoder :: c_sstv_decoder(float Fs)
   modes[sc2_120].samples_per_hsync = m_scale*Fs*hsync_pulse_ms/1000.0;
   modes[sc2_120].max_height = 256;
   }
-
-  cordic_init();
 }
 
 bool c_sstv_decoder :: decode_iq(int16_t sample_i, int16_t sample_q, uint16_t &pixel_y, uint16_t &pixel_x, uint8_t &pixel_colour, uint8_t &pixel, int16_t &smoothed_sample_16)
 {
 
+  //the FM discriminator needs a precise phase, but not the magnitude
   uint16_t magnitude;
   int16_t phase;
 
-  cordic_rectangular_to_polar(sample_i, sample_q, magnitude, phase);
-  frequency = last_phase-phase;
+  cordic<15, int32_t, cordic_phase>::rectangular_2_polar(sample_i, sample_q, magnitude, phase);
+  frequency = phase-last_phase;
   last_phase = phase;
 
   int16_t sample = (int32_t)frequency*15000>>16;
@@ -0,0 +1,149 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: cordic.h
+// description: convert rectangular to polar using cordic
+// License: MIT
+//
+// One cordic for the receiver and the decoders. The number of iterations,
+// the type used for the rotations and the outputs needed are template
+// parameters, so each caller pays only for the precision it uses. Each
+// iteration roughly halves the phase error. An int16_t state is cheapest on
+// paper, but wraps for magnitudes above about 19900, and on a Cortex-M an
+// int32_t state is no slower. The angle and gain tables are built at compile
+// time.
+//
+// The phase is atan2(q, i) in units of pi/32768, so a full turn wraps an
+// int16_t. The magnitude has the cordic gain removed.
+//
+// simulations/test_cordic.cpp reports the error and time of each precision.
+
+#ifndef CORDIC_H__
+#define CORDIC_H__
+
+#include <cstdint>
+#include "pico.h"
+
+enum e_cordic_outputs
+{
+  cordic_magnitude = 1,
+  cordic_phase = 2,
+  cordic_polar = cordic_magnitude | cordic_phase
+};
+
+namespace cordic_tables
+{
+  constexpr double pi = 3.14159265358979323846;
+
+  //atan(x) for x = 2^-k, the series converges quickly for x <= 1/2
+  constexpr double atan_pow2(uint8_t k)
+  {
+    if(k == 0) return pi / 4.0;
+    const double x = 1.0 / (1u << k);
+    double sum = 0.0, term = x;
+    for(uint8_t n = 0; n < 30; n++)
+    {
+      sum += (n & 1 ? -term : term) / (2 * n + 1);
+      term *= x * x;
+    }
+    return sum;
+  }
+
+  constexpr double sqrt(double x)
+  {
+    double y = x > 1.0 ? x : 1.0;
+    for(uint8_t n = 0; n < 40; n++) y = 0.5 * (y + x / y);
+    return y;
+  }
+
+  template<uint8_t iterations, uint8_t angle_fraction_bits> struct tables
+  {
+    int32_t angle[iterations];
+    uint16_t reciprocal_gain; //Q16
+
+    constexpr tables() : angle(), reciprocal_gain(0)
+    {
+      double gain = 1.0;
+      for(uint8_t k = 0; k < iterations; k++)
+      {
+        angle[k] = (int32_t)(atan_pow2(k) * (32768u << angle_fraction_bits) / pi + 0.5);
+        gain *= sqrt(1.0 + 1.0 / ((double)(1u << k) * (1u << k)));
+      }
+      reciprocal_gain = (uint16_t)(65536.0 / gain + 0.5);
+    }
+  };
+}
+
+template<uint8_t iterations, typename state_t = int32_t, uint8_t outputs = cordic_polar>
+struct cordic
+{
+  static_assert(iterations >= 1 && iterations <= 16, "cordic needs 1 to 16 iterations");
+  static_assert(outputs & cordic_polar, "cordic needs at least one output");
+
+  //a wider state keeps guard bits below the input, and fractions of the angle
+  static const uint8_t guard_bits = sizeof(state_t) > 2 ? 14 : 0;
+  static const uint8_t angle_fraction_bits = sizeof(state_t) > 2 ? 8 : 0;
+  static constexpr cordic_tables::tables<iterations, angle_fraction_bits> table = cordic_tables::tables<iterations, angle_fraction_bits>();
+
+  static __force_inline void rectangular_2_polar(int16_t i_16, int16_t q_16, uint16_t &magnitude, int16_t &phase)
+  {
+    state_t i = (int32_t)i_16 << guard_bits, q = (int32_t)q_16 << guard_bits;
+    int32_t angle = 0;
+
+    if (i < 0) {
+      // rotate by an initial +/- 90 degrees
+      const state_t temp_i = i;
+      if (q > 0) {
+        i = q; // subtract 90 degrees
+        q = -temp_i;
+        angle = 16384 << angle_fraction_bits;
+      } else {
+        i = -q; // add 90 degrees
+        q = temp_i;
+        angle = -(16384 << angle_fraction_bits);
+      }
+    }
+
+    for (uint8_t k = 0; k < iterations; k++) {
+      const state_t temp_i = i;
+      if (q > 0) {
+        // rotate clockwise
+        i += (q >> k);
+        q -= (temp_i >> k);
+        if(outputs & cordic_phase) angle += table.angle[k];
+      } else {
+        // rotate counterclockwise
+        i -= (q >> k);
+        q += (temp_i >> k);
+        if(outputs & cordic_phase) angle -= table.angle[k];
+      }
+    }
+
+    if(outputs & cordic_magnitude) magnitude = ((uint32_t)(i >> guard_bits) * table.reciprocal_gain) >> 16;
+    if(outputs & cordic_phase) phase = (angle + ((1 << angle_fraction_bits) >> 1)) >> angle_fraction_bits;
+  }
+
+  //convert a block of interleaved IQ pairs, outputs that aren't needed may
+  //be NULL
+  static __force_inline void block(const int16_t iq[], uint16_t magnitude[], int16_t phase[], uint16_t num_samples)
+  {
+    uint16_t unused_magnitude;
+    int16_t unused_phase;
+    for(uint16_t idx = 0; idx < num_samples; idx++)
+    {
+      rectangular_2_polar(iq[2 * idx], iq[2 * idx + 1],
+        outputs & cordic_magnitude ? magnitude[idx] : unused_magnitude,
+        outputs & cordic_phase ? phase[idx] : unused_phase);
+    }
+  }
+};
+
+template<uint8_t iterations, typename state_t, uint8_t outputs>
+constexpr cordic_tables::tables<iterations, cordic<iterations, state_t, outputs>::angle_fraction_bits> cordic<iterations, state_t, outputs>::table;
+
+#endif
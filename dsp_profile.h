@@ -0,0 +1,170 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: dsp_profile.h
+// description: optional timing of each stage of rx_dsp::process_block
+// License: MIT
+//
+
+#ifndef DSP_PROFILE_H
+#define DSP_PROFILE_H
+
+#include <stdint.h>
+
+enum e_dsp_stage
+{
+  dsp_stage_cic,             //cic decimation
+  dsp_stage_dc_removal,      //dc removal
+  dsp_stage_iq_correction,   //iq imbalance correction
+  dsp_stage_frequency_shift, //frequency shift
+  dsp_stage_fft_filter,      //fft filter, spectrum capture, noise reduction, notch
+  dsp_stage_demodulate,      //magnitude/phase, blanker, demodulator
+  dsp_stage_post_filters,    //de-emphasis, bass, treble
+  dsp_stage_agc,             //automatic gain control
+  dsp_stage_squelch,         //squelch
+  dsp_stage_output,          //audio capture, decoder and usb iq streaming
+  dsp_num_stages
+};
+
+static const char * const dsp_stage_names[dsp_num_stages] = {
+  "cic",
+  "dc",
+  "iq",
+  "shift",
+  "fft",
+  "demod",
+  "post",
+  "agc",
+  "sqlch",
+  "output",
+};
+
+//histogram bins are powers of 2, starting at 2^dsp_profile_first_bin ticks
+static const uint8_t dsp_profile_num_bins = 12;
+static const uint8_t dsp_profile_first_bin = 8;
+
+#ifdef DSP_PROFILE
+
+//Ticks are nanoseconds in simulation, and clock cycles on the target
+#ifdef SIMULATION
+#include <time.h>
+static const uint32_t dsp_profile_mask = 0xffffffffu;
+static inline uint32_t dsp_profile_now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+static inline uint32_t dsp_profile_ticks_per_ms()
+{
+  return 1000000u;
+}
+#elif defined(__riscv)
+#include "hardware/clocks.h"
+static const uint32_t dsp_profile_mask = 0xffffffffu;
+static inline uint32_t dsp_profile_now()
+{
+  uint32_t cycles;
+  asm volatile ("csrr %0, mcycle" : "=r" (cycles));
+  return cycles;
+}
+static inline uint32_t dsp_profile_ticks_per_ms()
+{
+  return clock_get_hz(clk_sys)/1000u;
+}
+#else
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
+//SysTick is 24 bits and counts down, it is enabled on first use by the core
+//that runs the DSP
+static const uint32_t dsp_profile_mask = 0xffffffu;
+static inline uint32_t dsp_profile_now()
+{
+  if(!(systick_hw->csr & 1u))
+  {
+    systick_hw->rvr = 0xffffffu;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 5u; //enabled, processor clock
+  }
+  return ~systick_hw->cvr;
+}
+static inline uint32_t dsp_profile_ticks_per_ms()
+{
+  return clock_get_hz(clk_sys)/1000u;
+}
+#endif
+
+struct s_dsp_profile
+{
+  uint64_t total[dsp_num_stages];
+  uint32_t min[dsp_num_stages];
+  uint32_t max[dsp_num_stages];
+  uint32_t histogram[dsp_num_stages][dsp_profile_num_bins];
+  uint32_t blocks;
+  uint32_t last;
+  volatile bool reset_requested;
+
+  void reset()
+  {
+    for(uint8_t stage = 0; stage < dsp_num_stages; ++stage)
+    {
+      total[stage] = 0;
+      min[stage] = UINT32_MAX;
+      max[stage] = 0;
+      for(uint8_t bin = 0; bin < dsp_profile_num_bins; ++bin) histogram[stage][bin] = 0;
+    }
+    blocks = 0;
+    reset_requested = false;
+  }
+
+  //from the other core, takes effect at the start of the next block
+  void request_reset()
+  {
+    reset_requested = true;
+  }
+
+  void start()
+  {
+    if(reset_requested) reset();
+    last = dsp_profile_now();
+  }
+
+  void end_stage(e_dsp_stage stage)
+  {
+    const uint32_t now = dsp_profile_now();
+    const uint32_t ticks = (now - last) & dsp_profile_mask;
+    last = now;
+
+    total[stage] += ticks;
+    if(ticks < min[stage]) min[stage] = ticks;
+    if(ticks > max[stage]) max[stage] = ticks;
+    int8_t bin = (31 - __builtin_clz(ticks | 1u)) - dsp_profile_first_bin;
+    if(bin < 0) bin = 0;
+    if(bin >= dsp_profile_num_bins) bin = dsp_profile_num_bins - 1;
+    histogram[stage][bin]++;
+  }
+
+  uint32_t average(uint8_t stage) const
+  {
+    return blocks ? total[stage]/blocks : 0;
+  }
+};
+
+#define DSP_PROFILE_START() profile.start()
+#define DSP_PROFILE_END_STAGE(stage) profile.end_stage(stage)
+#define DSP_PROFILE_END_BLOCK() profile.blocks++
+
+#else
+
+#define DSP_PROFILE_START()
+#define DSP_PROFILE_END_STAGE(stage)
+#define DSP_PROFILE_END_BLOCK()
+
+#endif
+
+#endif
@@ -2,21 +2,82 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <type_traits>
 
 #ifndef SIMULATION
 #include "pico/stdlib.h"
 #endif
+#include "pico.h"
+#include "rx_definitions.h"
 
-static const uint16_t max_m = 8; // the largest size of FFT supported
+static const uint16_t max_m = fft_max_order; // the largest size of FFT supported
 static const uint16_t max_n_over_2 = 1 << (max_m - 1);
 static int16_t fixed_cos_table[max_n_over_2];
 static int16_t fixed_sin_table[max_n_over_2];
 
+//radix-4 tables
+//
+//Twiddles for each radix-4 pass are packed in the order they are used. A pass
+//combining 4 sub-DFTs of size q needs W^k, W^2k, W^3k (W = e^-2pi.i/4q) for
+//k = 0..q-1. Passes have q = 1, 4, 16 ..., so the pass with sub-DFT size q
+//starts at triple (q-1)/3.
+//
+//An odd sized FFT ends with a radix-2 pass of span q, which needs W^k
+//(W = e^-2pi.i/2q) for k = 0..q-1, these start at entry q-1.
+//
+//The bit reversal permutation for each size is stored as a list of index
+//pairs to swap, the list for size m starts at swap_offset[m].
+struct s_twiddle
+{
+  int16_t real;
+  int16_t imag;
+};
+static const uint16_t max_radix4_twiddles = ((1 << (max_m & ~1u)) - 1) / 3;
+static const uint16_t max_radix2_twiddles = (1 << (max_m - 1)) - 1;
+static s_twiddle radix4_twiddles[max_radix4_twiddles][3];
+static s_twiddle radix2_twiddles[max_radix2_twiddles];
+typedef std::conditional<(max_m > 8), uint16_t, uint8_t>::type swap_index_t;
+static swap_index_t swap_pairs[1 << max_m][2];
+static uint16_t swap_offset[max_m + 2];
+
+static s_twiddle twiddle(unsigned k, unsigned n)
+{
+  return {float2fixed(cosf(2.0f * (float)M_PI * k / n)), float2fixed(-sinf(2.0f * (float)M_PI * k / n))};
+}
+
 void fft_initialise() {
   for (int i = 0; i < max_n_over_2; ++i) {
     fixed_cos_table[i] = float2fixed(cosf((float)i * M_PI / max_n_over_2));
     fixed_sin_table[i] = float2fixed(sinf((float)i * M_PI / max_n_over_2));
   }
+
+  for (unsigned q = 1; q < (1u << max_m); q <<= 2) {
+    for (unsigned k = 0; k < q; ++k) {
+      for (unsigned r = 1; r <= 3; ++r) {
+        radix4_twiddles[(q - 1) / 3 + k][r - 1] = twiddle(r * k, 4 * q);
+      }
+    }
+  }
+
+  for (unsigned q = 1; q < (1u << (max_m - 1)); q <<= 1) {
+    for (unsigned k = 0; k < q; ++k) {
+      radix2_twiddles[q - 1 + k] = twiddle(k, 2 * q);
+    }
+  }
+
+  uint16_t pairs = 0;
+  for (unsigned m = 0; m <= max_m; ++m) {
+    swap_offset[m] = pairs;
+    for (unsigned i = 0; i < (1u << m); ++i) {
+      const unsigned ip = bit_reverse(i, m);
+      if (i < ip) {
+        swap_pairs[pairs][0] = i;
+        swap_pairs[pairs][1] = ip;
+        pairs++;
+      }
+    }
+  }
+  swap_offset[max_m + 1] = pairs;
 }
 
 #ifndef SIMULATION
@@ -24,7 +85,7 @@ unsigned __not_in_flash_func(bit_reverse)(unsigned x, unsigned m) {
 #else
 unsigned bit_reverse(unsigned x, unsigned m) {
 #endif
-    static const unsigned char lookup[] = {
+    static const unsigned char __not_in_flash("bit_reverse_lookup") lookup[] = {
         0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0,
         0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
         0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8,
@@ -199,3 +260,213 @@ void fixed_ifft(int16_t reals[], int16_t imaginaries[], unsigned m) {
 #endif
   fixed_fft(imaginaries, reals, m, true);
 }
+
+//(a + jb)(c + jd) with a single rounding
+static inline void complex_product(int32_t &real, int32_t &imag, int16_t a, int16_t b, const s_twiddle &w) {
+  real = ((int32_t)a * w.real - (int32_t)b * w.imag + K) >> fraction_bits;
+  imag = ((int32_t)a * w.imag + (int32_t)b * w.real + K) >> fraction_bits;
+}
+
+static inline void bit_reverse_data(int16_t reals[], int16_t imaginaries[], unsigned m) {
+  for (uint16_t pair = swap_offset[m]; pair < swap_offset[m + 1]; ++pair) {
+    const unsigned i = swap_pairs[pair][0];
+    const unsigned ip = swap_pairs[pair][1];
+    const int16_t temp_real = reals[i];
+    const int16_t temp_imaginary = imaginaries[i];
+    reals[i] = reals[ip];
+    imaginaries[i] = imaginaries[ip];
+    reals[ip] = temp_real;
+    imaginaries[ip] = temp_imaginary;
+  }
+}
+
+//combine the 4 sub-DFTs of size q starting at i, into one of size 4q
+static inline void radix4_butterfly(int16_t reals[], int16_t imaginaries[], unsigned i, unsigned q, unsigned k, const s_twiddle twiddles[3]) {
+  int32_t ar = reals[i],         ai = imaginaries[i];
+  int32_t br, bi, cr, ci, dr, di;
+
+  // Treat rotations by zero as a special case
+  if (k == 0) {
+    cr = reals[i + q];     ci = imaginaries[i + q];
+    br = reals[i + 2 * q]; bi = imaginaries[i + 2 * q];
+    dr = reals[i + 3 * q]; di = imaginaries[i + 3 * q];
+  } else {
+    complex_product(cr, ci, reals[i + q], imaginaries[i + q], twiddles[1]);
+    complex_product(br, bi, reals[i + 2 * q], imaginaries[i + 2 * q], twiddles[0]);
+    complex_product(dr, di, reals[i + 3 * q], imaginaries[i + 3 * q], twiddles[2]);
+  }
+
+  // sub-DFTs 0 and 2 are at offsets 0 and q, 1 and 3 at 2q and 3q
+  const int32_t sum02_r = ar + cr,  sum02_i = ai + ci;
+  const int32_t diff02_r = ar - cr, diff02_i = ai - ci;
+  const int32_t sum13_r = br + dr,  sum13_i = bi + di;
+  const int32_t diff13_r = br - dr, diff13_i = bi - di;
+
+  // after every second stage lose 1 bit
+  reals[i]                 = (sum02_r + sum13_r) >> 1;
+  imaginaries[i]           = (sum02_i + sum13_i) >> 1;
+  reals[i + q]             = (diff02_r + diff13_i) >> 1;
+  imaginaries[i + q]       = (diff02_i - diff13_r) >> 1;
+  reals[i + 2 * q]         = (sum02_r - sum13_r) >> 1;
+  imaginaries[i + 2 * q]   = (sum02_i - sum13_i) >> 1;
+  reals[i + 3 * q]         = (diff02_r - diff13_i) >> 1;
+  imaginaries[i + 3 * q]   = (diff02_i + diff13_r) >> 1;
+}
+
+//final radix-2 pass for odd sizes, span q
+static inline void radix2_pass(int16_t reals[], int16_t imaginaries[], unsigned q) {
+  const s_twiddle *twiddles = &radix2_twiddles[q - 1];
+  for (unsigned k = 0; k < q; ++k) {
+    int32_t br = reals[k + q], bi = imaginaries[k + q];
+    if (k) complex_product(br, bi, reals[k + q], imaginaries[k + q], twiddles[k]);
+    const int32_t ar = reals[k], ai = imaginaries[k];
+    reals[k]           = ar + br;
+    imaginaries[k]     = ai + bi;
+    reals[k + q]       = ar - br;
+    imaginaries[k + q] = ai - bi;
+  }
+}
+
+//Radix-4 FFT, each pass does the work of 2 radix-2 stages with 3 rather than
+//4 complex multiplies per 4 points. The data is in bit reversed order, so the
+//4 sub-DFTs in each group are in the order 0, 2, 1, 3. Scaling is the same as
+//fixed_fft, 1 bit is lost after every second radix-2 stage, i.e. once per
+//radix-4 pass. When m is odd, a final radix-2 pass (without scaling) is used.
+#ifndef SIMULATION
+void __not_in_flash_func(fixed_fft_radix4)(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#else
+void fixed_fft_radix4(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#endif
+  bit_reverse_data(reals, imaginaries, m);
+  fixed_fft_radix4_bit_reversed(reals, imaginaries, m);
+}
+
+//as fixed_fft_radix4, with the input already in bit reversed order, so that
+//the caller can permute the data as it is loaded
+#ifndef SIMULATION
+void __not_in_flash_func(fixed_fft_radix4_bit_reversed)(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#else
+void fixed_fft_radix4_bit_reversed(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#endif
+  const unsigned n = 1 << m;
+
+  // radix-4 passes
+  unsigned q = 1;
+  for (; 4 * q <= n; q <<= 2) {
+    const s_twiddle (*twiddles)[3] = &radix4_twiddles[(q - 1) / 3];
+    for (unsigned k = 0; k < q; ++k) {
+      for (unsigned i = k; i < n; i += 4 * q) {
+        radix4_butterfly(reals, imaginaries, i, q, k, twiddles[k]);
+      }
+    }
+  }
+
+  if (q < n) radix2_pass(reals, imaginaries, q);
+}
+
+#ifndef SIMULATION
+void __not_in_flash_func(fixed_ifft_radix4)(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#else
+void fixed_ifft_radix4(int16_t reals[], int16_t imaginaries[], unsigned m) {
+#endif
+  fixed_fft_radix4(imaginaries, reals, m);
+}
+
+//as radix4_butterfly, but sub-DFTs that are not active are known to be zero
+static inline void radix4_butterfly_sparse(int16_t reals[], int16_t imaginaries[], unsigned i, unsigned q, unsigned k, const s_twiddle twiddles[3], const bool active[4]) {
+  int32_t ar = 0, ai = 0, br = 0, bi = 0, cr = 0, ci = 0, dr = 0, di = 0;
+
+  if (active[0]) {
+    ar = reals[i]; ai = imaginaries[i];
+  }
+  if (active[1]) {
+    cr = reals[i + q]; ci = imaginaries[i + q];
+    if (k) complex_product(cr, ci, cr, ci, twiddles[1]);
+  }
+  if (active[2]) {
+    br = reals[i + 2 * q]; bi = imaginaries[i + 2 * q];
+    if (k) complex_product(br, bi, br, bi, twiddles[0]);
+  }
+  if (active[3]) {
+    dr = reals[i + 3 * q]; di = imaginaries[i + 3 * q];
+    if (k) complex_product(dr, di, dr, di, twiddles[2]);
+  }
+
+  const int32_t sum02_r = ar + cr,  sum02_i = ai + ci;
+  const int32_t diff02_r = ar - cr, diff02_i = ai - ci;
+  const int32_t sum13_r = br + dr,  sum13_i = bi + di;
+  const int32_t diff13_r = br - dr, diff13_i = bi - di;
+
+  reals[i]                 = (sum02_r + sum13_r) >> 1;
+  imaginaries[i]           = (sum02_i + sum13_i) >> 1;
+  reals[i + q]             = (diff02_r + diff13_i) >> 1;
+  imaginaries[i + q]       = (diff02_i - diff13_r) >> 1;
+  reals[i + 2 * q]         = (sum02_r - sum13_r) >> 1;
+  imaginaries[i + 2 * q]   = (sum02_i - sum13_i) >> 1;
+  reals[i + 3 * q]         = (diff02_r - diff13_i) >> 1;
+  imaginaries[i + 3 * q]   = (diff02_i + diff13_r) >> 1;
+}
+
+//Inverse FFT of a spectrum that is zero outside a few bands of bins.
+//
+//Before each radix-4 pass, each group of 4q points holds the sub-DFTs of the
+//inputs congruent to one residue mod n/4q. If no band contains a bin with
+//that residue, the whole group is zero, and stays zero through the pass, so
+//it is skipped. Within a group, sub-DFTs that are known to be zero are not
+//loaded or multiplied. The result is bit exact with fixed_ifft_radix4. Wide
+//bands leave little to skip, so the full transform is used instead.
+#ifndef SIMULATION
+void __not_in_flash_func(fixed_ifft_radix4_pruned)(int16_t reals[], int16_t imaginaries[], unsigned m, const s_fft_band bands[], uint8_t num_bands) {
+#else
+void fixed_ifft_radix4_pruned(int16_t reals[], int16_t imaginaries[], unsigned m, const s_fft_band bands[], uint8_t num_bands) {
+#endif
+  const unsigned n = 1 << m;
+
+  unsigned active_bins = 0;
+  for (uint8_t band = 0; band < num_bands; ++band) active_bins += bands[band].last - bands[band].first + 1;
+  if (2 * active_bins > n) {
+    fixed_ifft_radix4(reals, imaginaries, m);
+    return;
+  }
+
+  //active[r] is set if any bin is congruent to r modulo the size of the
+  //sub-DFTs being combined, folded down as each pass combines 4 of them
+  bool active[1 << max_m] = {};
+  for (uint8_t band = 0; band < num_bands; ++band) {
+    for (unsigned bin = bands[band].first; bin <= bands[band].last; ++bin) active[bin & (n - 1)] = true;
+  }
+
+  //the inverse is a forward transform with real and imaginary swapped
+  bit_reverse_data(imaginaries, reals, m);
+
+  unsigned q = 1;
+  unsigned residue_bits = m - 2;
+  for (; 4 * q <= n; q <<= 2, residue_bits -= 2) {
+    const s_twiddle (*twiddles)[3] = &radix4_twiddles[(q - 1) / 3];
+    const unsigned modulus = 1 << residue_bits;
+    for (unsigned residue = 0; residue < modulus; ++residue) {
+      //sub-DFTs in the order 0, 2, 1, 3 hold residues mod 4*modulus
+      const bool sub_active[4] = {
+        active[residue],
+        active[residue + 2 * modulus],
+        active[residue + modulus],
+        active[residue + 3 * modulus],
+      };
+      active[residue] = sub_active[0] || sub_active[1] || sub_active[2] || sub_active[3];
+      if (!active[residue]) continue;
+
+      const unsigned group = bit_reverse(residue, residue_bits) * 4 * q;
+      if (sub_active[0] && sub_active[1] && sub_active[2] && sub_active[3]) {
+        for (unsigned k = 0; k < q; ++k) {
+          radix4_butterfly(imaginaries, reals, group + k, q, k, twiddles[k]);
+        }
+      } else {
+        for (unsigned k = 0; k < q; ++k) {
+          radix4_butterfly_sparse(imaginaries, reals, group + k, q, k, twiddles[k], sub_active);
+        }
+      }
+    }
+  }
+
+  if (q < n) radix2_pass(imaginaries, reals, q);
+}
@@ -6,9 +6,21 @@
 const uint8_t fraction_bits = 14;
 const int16_t K  =  (1 << (fraction_bits - 1));
 
+//an inclusive range of bins, for pruned transforms
+struct s_fft_band
+{
+  uint16_t first;
+  uint16_t last;
+};
+
 void fft_initialise();
+unsigned bit_reverse(unsigned x, unsigned m);
 void fixed_fft(int16_t reals[], int16_t imaginaries[], unsigned m, bool scale=true);
 void fixed_ifft(int16_t reals[], int16_t imaginaries[], unsigned m);
+void fixed_fft_radix4(int16_t reals[], int16_t imaginaries[], unsigned m);
+void fixed_fft_radix4_bit_reversed(int16_t reals[], int16_t imaginaries[], unsigned m);
+void fixed_ifft_radix4(int16_t reals[], int16_t imaginaries[], unsigned m);
+void fixed_ifft_radix4_pruned(int16_t reals[], int16_t imaginaries[], unsigned m, const s_fft_band bands[], uint8_t num_bands);
 
 static inline int16_t float2fixed(float float_value) {
         return round(float_value * (1 << fraction_bits));
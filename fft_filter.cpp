@@ -20,6 +20,7 @@
 #include "utils.h"
 #include "noise_reduction.h"
 #include "cic_corrections.h"
+#include "tone_controls.h"
 #include "fft.h"
 #include "utils.h"
 
@@ -27,20 +28,230 @@
 #include "pico/stdlib.h"
 #endif
 
+static inline int16_t apply_gain(uint16_t gain, int16_t sample)
+{
+  const int32_t adjusted_sample = ((int32_t)sample * gain) >> 8;
+  return std::max(std::min(adjusted_sample, (int32_t)INT16_MAX), (int32_t)INT16_MIN);
+}
+
+//raised cosine edges, taper_Hz wide and centred on the band edges. Edges can
+//fall anywhere between bins, and a 256 point FFT (117Hz bins) with edges half
+//way between bins is close to the old brick wall filter. The frequency is in
+//1/256Hz, the gain is x2^15.
+#ifndef SIMULATION
+template<uint8_t fft_order>
+uint32_t __not_in_flash_func(fft_filter<fft_order>::taper_gain)(int32_t frequency_Hz_x256, int16_t low_edge_Hz, int16_t high_edge_Hz) const {
+#else
+template<uint8_t fft_order>
+uint32_t fft_filter<fft_order>::taper_gain(int32_t frequency_Hz_x256, int16_t low_edge_Hz, int16_t high_edge_Hz) const {
+#endif
+  const int32_t taper_Hz_x256 = taper_Hz << 8;
+  const int32_t rise = frequency_Hz_x256 - ((int32_t)low_edge_Hz << 8) + taper_Hz_x256/2;
+  const int32_t fall = ((int32_t)high_edge_Hz << 8) + taper_Hz_x256/2 - frequency_Hz_x256;
+  if(rise <= 0 || fall <= 0) return 0;
+
+  //interpolate between the 1Hz steps of the table
+  uint32_t gain = 1u << 15;
+  if(rise < taper_Hz_x256)
+  {
+    const uint16_t idx = rise >> 8;
+    gain = taper[idx] + (((taper[idx + 1] - taper[idx]) * (rise & 0xff)) >> 8);
+  }
+  if(fall < taper_Hz_x256)
+  {
+    const uint16_t idx = fall >> 8;
+    gain = (gain * (taper[idx] + (((taper[idx + 1] - taper[idx]) * (fall & 0xff)) >> 8))) >> 15;
+  }
+  return gain;
+}
+
+//the demodulator moves each frequency of the pass band to an audio
+//frequency, the tone controls are applied at that frequency. The gain is
+//x2^15, limited so that the CIC correction can't overflow it.
+static inline uint32_t apply_tone_controls(const tone_control_gains &tone_gains, const s_filter_control &filter_control, int32_t frequency_Hz_x256, uint32_t gain)
+{
+  const uint32_t audio_Hz_x256 = abs(frequency_Hz_x256 + ((int32_t)filter_control.audio_shift_Hz << 8));
+  const uint32_t tone_gain = tone_gains.gain(filter_control.deemphasis, filter_control.bass, filter_control.treble, audio_Hz_x256);
+  return std::min((gain * tone_gain) >> 12, (uint32_t)1u << 19);
+}
+
+#ifndef SIMULATION
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::build_mask)(const s_filter_control &filter_control, s_mask &new_mask) {
+#else
+template<uint8_t fft_order>
+void fft_filter<fft_order>::build_mask(const s_filter_control &filter_control, s_mask &new_mask) {
+#endif
+
+  const int32_t bin_width_Hz_x256 = ((uint32_t)adc_sample_rate << 8) / (cic_decimation_rate * fft_size);
+  const bool tone_controls = filter_control.deemphasis || filter_control.bass || filter_control.treble;
+  new_mask.upper_active = false;
+  new_mask.lower_active = false;
+
+  //DC and positive frequencies
+  for (uint16_t bin = 0; bin <= new_fft_size/2u; bin++) {
+    uint32_t gain = taper_gain(bin * bin_width_Hz_x256, filter_control.low_edge_Hz, filter_control.high_edge_Hz);
+    if(tone_controls && gain) gain = apply_tone_controls(tone_gains, filter_control, bin * bin_width_Hz_x256, gain);
+    new_mask.gain[bin] = std::min((gain * cic.gain(bin + filter_control.fft_bin) + (1u << 14)) >> 15, (uint32_t)UINT16_MAX);
+    if(!new_mask.gain[bin]) continue;
+    if(!new_mask.upper_active) new_mask.upper_first_bin = bin;
+    new_mask.upper_last_bin = bin;
+    new_mask.upper_active = true;
+  }
+
+  //negative frequencies
+  for (uint16_t bin = 1; bin < new_fft_size/2u; bin++) {
+    uint32_t gain = taper_gain(-(int32_t)bin * bin_width_Hz_x256, filter_control.low_edge_Hz, filter_control.high_edge_Hz);
+    if(tone_controls && gain) gain = apply_tone_controls(tone_gains, filter_control, -(int32_t)bin * bin_width_Hz_x256, gain);
+    const uint16_t idx = new_fft_size - bin;
+    new_mask.gain[idx] = std::min((gain * cic.gain(filter_control.fft_bin - bin) + (1u << 14)) >> 15, (uint32_t)UINT16_MAX);
+    if(!new_mask.gain[idx]) continue;
+    if(!new_mask.lower_active) new_mask.lower_first_bin = bin;
+    new_mask.lower_last_bin = bin;
+    new_mask.lower_active = true;
+  }
+}
+
+//called when the pass band, tone controls or tuning offset change, at most
+//once per block and never while a block is being filtered
+#ifndef SIMULATION
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::set_mask)(const s_filter_control &filter_control) {
+#else
+template<uint8_t fft_order>
+void fft_filter<fft_order>::set_mask(const s_filter_control &filter_control) {
+#endif
+  build_mask(filter_control, mask);
+}
+
+//keep the strongest max_notches peaks of this block, strongest first
+#ifndef SIMULATION
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::find_peak)(uint16_t magnitude, uint16_t bin) {
+#else
+template<uint8_t fft_order>
+void fft_filter<fft_order>::find_peak(uint16_t magnitude, uint16_t bin) {
+#endif
+  if(magnitude <= peaks[max_notches-1].magnitude) return;
+
+  //the window spreads a carrier over neighbouring bins, only keep the
+  //strongest bin of each
+  uint8_t k = max_notches-1;
+  for (uint8_t j = 0; j < max_notches; j++) {
+    if(peaks[j].magnitude && abs(bin - peaks[j].bin) <= 2)
+    {
+      if(magnitude <= peaks[j].magnitude) return;
+      k = j;
+      break;
+    }
+  }
+
+  //insert in order
+  while(k > 0 && peaks[k-1].magnitude < magnitude)
+  {
+    peaks[k] = peaks[k-1];
+    k--;
+  }
+  peaks[k] = {magnitude, bin};
+}
+
+//a peak that stays in the same place (within a bin) for long enough is a
+//carrier, and is notched. The notch is removed once the carrier has gone for
+//a while.
+#ifndef SIMULATION
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::update_notches)(bool enable_auto_notch) {
+#else
+template<uint8_t fft_order>
+void fft_filter<fft_order>::update_notches(bool enable_auto_notch) {
+#endif
+  const uint8_t notch_on_count = 128u;
+  const uint8_t notch_off_count = 64u;
+  const uint16_t full_depth = 256u;
+  const uint16_t depth_step = 16u;
+
+  if(!enable_auto_notch)
+  {
+    for (uint8_t k = 0; k < max_notches; k++) {
+      notches[k] = {0, 0, 0, false};
+    }
+    return;
+  }
+
+  bool seen[max_notches] = {false};
+  for (uint8_t j = 0; j < max_notches; j++) {
+    if(!peaks[j].magnitude) break;
+
+    //follow a known carrier
+    bool matched = false;
+    for (uint8_t k = 0; k < max_notches; k++) {
+      s_notch &notch = notches[k];
+      if(!seen[k] && (notch.confirm_count || notch.depth) && abs(peaks[j].bin - notch.bin) <= 1)
+      {
+        notch.bin = peaks[j].bin;
+        if(notch.confirm_count < 255u) notch.confirm_count++;
+        seen[k] = matched = true;
+        break;
+      }
+    }
+
+    //or start to confirm a new one in a free slot
+    for (uint8_t k = 0; k < max_notches && !matched; k++) {
+      s_notch &notch = notches[k];
+      if(!notch.confirm_count && !notch.depth)
+      {
+        notch = {peaks[j].bin, 1, 0, false};
+        seen[k] = matched = true;
+      }
+    }
+  }
+
+  for (uint8_t k = 0; k < max_notches; k++) {
+    s_notch &notch = notches[k];
+    if(!seen[k] && notch.confirm_count) notch.confirm_count--;
+
+    //hysteresis, then ramp the depth to avoid clicks
+    if(notch.confirm_count > notch_on_count) notch.active = true;
+    if(notch.confirm_count < notch_off_count) notch.active = false;
+    if(notch.active) notch.depth = std::min((uint16_t)(notch.depth + depth_step), full_depth);
+    else notch.depth = notch.depth > depth_step ? notch.depth - depth_step : 0;
+  }
+}
+
 #ifndef SIMULATION
-void __not_in_flash_func(fft_filter::filter_block)(int16_t sample_real[], int16_t sample_imag[], s_filter_control &filter_control, int16_t capture[]) {
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::apply_notches)(int16_t sample_real[], int16_t sample_imag[]) {
 #else
-void fft_filter::filter_block(int16_t sample_real[], int16_t sample_imag[], s_filter_control &filter_control, int16_t capture[]) {
+template<uint8_t fft_order>
+void fft_filter<fft_order>::apply_notches(int16_t sample_real[], int16_t sample_imag[]) {
 #endif
+  for (uint8_t k = 0; k < max_notches; k++) {
+    const s_notch &notch = notches[k];
+    if(!notch.depth || notch.bin <= 3u || notch.bin >= new_fft_size-3u) continue;
 
-  // window
-  for (uint16_t i = 0; i < fft_size; i++) {
-    sample_real[i] = product(sample_real[i], window[i]);
-    sample_imag[i] = product(sample_imag[i], window[i]);
+    //attenuate the peak and the bins either side
+    const int32_t gain = 256 - notch.depth;
+    for (uint16_t bin = notch.bin - 1; bin <= notch.bin + 1u; bin++) {
+      sample_real[bin] = (sample_real[bin] * gain) >> 8;
+      sample_imag[bin] = (sample_imag[bin] * gain) >> 8;
+    }
   }
+}
+
+#ifndef SIMULATION
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::filter_block)(int16_t sample_real[], int16_t sample_imag[], s_filter_control &filter_control, int16_t capture[]) {
+#else
+template<uint8_t fft_order>
+void fft_filter<fft_order>::filter_block(int16_t sample_real[], int16_t sample_imag[], s_filter_control &filter_control, int16_t capture[]) {
+#endif
 
-  // forward FFT
-  fixed_fft(sample_real, sample_imag, 8);
+  // forward FFT, the input was windowed (and bit reversed) as it was loaded
+#ifdef PICORX_FFT_RADIX2
+  fixed_fft(sample_real, sample_imag, fft_order);
+#else
+  fixed_fft_radix4_bit_reversed(sample_real, sample_imag, fft_order);
+#endif
 
   if(filter_control.capture)
   {
@@ -49,51 +260,55 @@ void fft_filter::filter_block(int16_t sample_real[], int16_t sample_imag[], s_fi
     }
   }
 
-  //largest bin
-  int16_t peak = 0;
-  int16_t next_peak = 0;
-  uint16_t peak_bin = 0;
+  //track the noise floor of every bin of the decimated spectrum, before the
+  //pass band is applied, so that it is ready whenever the filter changes
+  for (uint16_t bin = 0; bin < new_fft_size; bin++) {
+    const uint16_t idx = bin <= new_fft_size/2u ? bin : bin + fft_size - new_fft_size;
+    noise_floors.update(bin, rectangular_2_magnitude(sample_real[idx], sample_imag[idx]));
+  }
+  noise_floors.end_block(filter_control.noise_smoothing);
+
+  uint32_t signal_sum = 0;
+  uint32_t noise_sum = 0;
+
+  //strongest peaks in the pass band, for the auto notch
+  for (uint8_t k = 0; k < max_notches; k++) {
+    peaks[k] = {0, 0};
+  }
 
   //DC and positive frequencies
   for (uint16_t i = 0; i < (new_fft_size/2u) + 1; i++) {
     //clear bins outside pass band
-    if(!filter_control.upper_sideband || i < filter_control.start_bin || i > filter_control.stop_bin)
+    if(!mask.upper_active || i < mask.upper_first_bin || i > mask.upper_last_bin)
     {
       sample_real[i] = 0;
       sample_imag[i] = 0;
     }
     else
     {
-      sample_real[i] = cic_correct(i, filter_control.fft_bin, sample_real[i]);
-      sample_imag[i] = cic_correct(i, filter_control.fft_bin, sample_imag[i]);
+      sample_real[i] = apply_gain(mask.gain[i], sample_real[i]);
+      sample_imag[i] = apply_gain(mask.gain[i], sample_imag[i]);
+      signal_sum += (noise_floors[i].signal * mask.gain[i]) >> 8;
+      //the floor of a quiet bin rounds down to zero, it is at least one
+      noise_sum += (std::max(noise_floors[i].noise, (uint16_t)1) * mask.gain[i]) >> 8;
 
-      //capture highest and second highest peak
-      uint16_t magnitude = rectangular_2_magnitude(sample_real[i], sample_imag[i]);
-      if(magnitude > peak)
+      if(filter_control.enable_auto_notch)
       {
-        peak = magnitude; 
-        peak_bin = i;
+        find_peak(rectangular_2_magnitude(sample_real[i], sample_imag[i]), i);
       }
-      else if(magnitude > next_peak)
-      {
-        next_peak = magnitude;
-      }
-
     }
   }
 
   //apply noise filtering to DC and positive frequencies
-  if(filter_control.enable_noise_reduction && filter_control.upper_sideband)
+  if(filter_control.enable_noise_reduction && mask.upper_active)
   {
-    const uint16_t start_bin = std::max((uint16_t)4, filter_control.start_bin);
+    const uint16_t start_bin = std::max((uint16_t)4, mask.upper_first_bin);
     noise_reduction(
-      sample_real, 
-      sample_imag, 
-      positive_noise_estimate, 
-      positive_signal_estimate, 
-      start_bin, 
-      filter_control.stop_bin,
-      filter_control.noise_smoothing,
+      sample_real,
+      sample_imag,
+      noise_floors.estimates(),
+      start_bin,
+      std::min(mask.upper_last_bin, (uint16_t)(new_fft_size/2u - 1u)),
       filter_control.noise_threshold);
   }
 
@@ -101,87 +316,95 @@ void fft_filter::filter_block(int16_t sample_real[], int16_t sample_imag[], s_fi
   for (uint16_t i = 0; i < (new_fft_size/2u)-1; i++) {
     const uint16_t bin = new_fft_size/2 - i - 1;
     const uint16_t new_idx = (new_fft_size/2u) + 1 + i;
-    if(!filter_control.lower_sideband || bin < filter_control.start_bin || bin > filter_control.stop_bin)
+    if(!mask.lower_active || bin < mask.lower_first_bin || bin > mask.lower_last_bin)
     {
       sample_real[new_idx] = 0;
       sample_imag[new_idx] = 0;
     }
     else
     {
-      sample_real[new_idx] = cic_correct(bin, filter_control.fft_bin, sample_real[fft_size - (new_fft_size/2u) + i + 1]);
-      sample_imag[new_idx] = cic_correct(bin, filter_control.fft_bin, sample_imag[fft_size - (new_fft_size/2u) + i + 1]);
+      sample_real[new_idx] = apply_gain(mask.gain[new_idx], sample_real[fft_size - (new_fft_size/2u) + i + 1]);
+      sample_imag[new_idx] = apply_gain(mask.gain[new_idx], sample_imag[fft_size - (new_fft_size/2u) + i + 1]);
+      signal_sum += (noise_floors[new_idx].signal * mask.gain[new_idx]) >> 8;
+      noise_sum += (std::max(noise_floors[new_idx].noise, (uint16_t)1) * mask.gain[new_idx]) >> 8;
 
-      //capture highest and second highest peak
-      uint16_t magnitude = rectangular_2_magnitude(sample_real[new_idx], sample_imag[new_idx]);
-      if(magnitude > peak)
+      if(filter_control.enable_auto_notch)
       {
-        peak = magnitude; 
-        peak_bin = new_idx;
-      }
-      else if(magnitude > next_peak)
-      {
-        next_peak = magnitude;
+        find_peak(rectangular_2_magnitude(sample_real[new_idx], sample_imag[new_idx]), new_idx);
       }
     }
   }
 
   //apply noise filtering to negative frequencies
-  if(filter_control.enable_noise_reduction && filter_control.lower_sideband)
+  if(filter_control.enable_noise_reduction && mask.lower_active)
   {
-    const uint16_t start_bin = std::max((uint16_t)2, filter_control.start_bin);
+    const uint16_t start_bin = std::max((uint16_t)2, mask.lower_first_bin);
     noise_reduction(
-      &sample_real[new_fft_size/2u], 
-      &sample_imag[new_fft_size/2u], 
-      negative_noise_estimate, 
-      negative_signal_estimate, 
-      new_fft_size/2u-1-filter_control.stop_bin, 
-      new_fft_size/2u-1-start_bin,
-      filter_control.noise_smoothing,
+      sample_real,
+      sample_imag,
+      noise_floors.estimates(),
+      new_fft_size - mask.lower_last_bin,
+      new_fft_size - start_bin,
       filter_control.noise_threshold);
   }
 
-  if(filter_control.enable_auto_notch)
-  {
-    //check for a consistent peak
-    const uint8_t confirm_threshold = 255u;
-    static uint8_t confirm_count = 0u;
-    static uint8_t last_peak_bin = 0u;
-    if(peak_bin == last_peak_bin && confirm_count < confirm_threshold) confirm_count++;
-    if(peak_bin != last_peak_bin && confirm_count > 0) confirm_count--;
-    last_peak_bin = peak_bin;
-
-    //remove highest bin
-    if((confirm_count > confirm_threshold/2u) && (peak_bin > 3u) && (peak_bin < new_fft_size-3u))
-    {
-      sample_real[peak_bin] = 0;
-      sample_imag[peak_bin] = 0;
-      sample_real[peak_bin+1] = 0;
-      sample_imag[peak_bin+1] = 0;
-      sample_real[peak_bin-1] = 0;
-      sample_imag[peak_bin-1] = 0;
-    }
-  }
+  passband_signal = signal_sum;
+  passband_noise = noise_sum;
+
+  update_notches(filter_control.enable_auto_notch);
+  apply_notches(sample_real, sample_imag);
 
   // inverse FFT
-  fixed_ifft(sample_real, sample_imag, 7);
+#ifdef PICORX_FFT_RADIX2
+  fixed_ifft(sample_real, sample_imag, fft_order - 1);
+#else
+  //only the pass band bins are non-zero, skip the rest where possible
+  s_fft_band bands[2];
+  uint8_t num_bands = 0;
+  if(mask.upper_active)
+  {
+    bands[num_bands++] = {mask.upper_first_bin, mask.upper_last_bin};
+  }
+  if(mask.lower_active)
+  {
+    bands[num_bands++] = {(uint16_t)(new_fft_size - mask.lower_last_bin), (uint16_t)(new_fft_size - mask.lower_first_bin)};
+  }
+  fixed_ifft_radix4_pruned(sample_real, sample_imag, fft_order - 1, bands, num_bands);
+#endif
 
 }
 
 
 #ifndef SIMULATION
-void __not_in_flash_func(fft_filter::process_sample)(int16_t sample_iq[], s_filter_control &filter_control, int16_t capture[]) {
+template<uint8_t fft_order>
+void __not_in_flash_func(fft_filter<fft_order>::process_sample)(int16_t sample_iq[], s_filter_control &filter_control, int16_t capture[]) {
 #else
-void fft_filter::process_sample(int16_t sample_iq[], s_filter_control &filter_control, int16_t capture[]) {
+template<uint8_t fft_order>
+void fft_filter<fft_order>::process_sample(int16_t sample_iq[], s_filter_control &filter_control, int16_t capture[]) {
 #endif
 
-  int16_t real[fft_size];
-  int16_t imag[fft_size];
+  //the work buffers alternate, the last one still holds the second half of
+  //the last inverse FFT for the overlap-add
+  int16_t *real = work_real[work_index];
+  int16_t *imag = work_imag[work_index];
+  const int16_t *last_output_real = &work_real[work_index ^ 1][new_fft_size/2u];
+  const int16_t *last_output_imag = &work_imag[work_index ^ 1][new_fft_size/2u];
+  work_index ^= 1;
 
+  //window the last and new halves as they are loaded
   for (uint16_t i = 0; i < (fft_size/2u); i++) {
-    real[i] = last_input_real[i];
-    imag[i] = last_input_imag[i];
-    real[fft_size/2u + i] = sample_iq[2 * i];
-    imag[fft_size/2u + i] = sample_iq[2 * i + 1];
+#ifdef PICORX_FFT_RADIX2
+    const uint16_t last_idx = i;
+    const uint16_t new_idx = fft_size/2u + i;
+#else
+    //in bit reversed order, the new half differs in the least significant bit
+    const uint16_t last_idx = bit_reverse(i, fft_order);
+    const uint16_t new_idx = last_idx + 1;
+#endif
+    real[last_idx] = product(last_input_real[i], window[i]);
+    imag[last_idx] = product(last_input_imag[i], window[i]);
+    real[new_idx] = product(sample_iq[2 * i], window[fft_size/2u + i]);
+    imag[new_idx] = product(sample_iq[2 * i + 1], window[fft_size/2u + i]);
     last_input_real[i] = sample_iq[2 * i];
     last_input_imag[i] = sample_iq[2 * i + 1];
   }
@@ -192,8 +415,15 @@ void fft_filter::process_sample(int16_t sample_iq[], s_filter_control &filter_co
   for (uint16_t i = 0; i < (new_fft_size/2u); i++) {
     sample_iq[2 * i] = real[i] + last_output_real[i];
     sample_iq[2 * i + 1] = imag[i] + last_output_imag[i];
-    last_output_real[i] = real[new_fft_size/2u + i];
-    last_output_imag[i] = imag[new_fft_size/2u + i];
   }
 
 }
+
+#ifdef SIMULATION
+template class fft_filter<7>;
+template class fft_filter<8>;
+template class fft_filter<9>;
+template class fft_filter<10>;
+#else
+template class fft_filter<fft_order>;
+#endif
@@ -17,35 +17,93 @@
 #include <cmath>
 
 #include "fft.h"
+#include "cic_corrections.h"
+#include "noise_floor.h"
+#include "tone_controls.h"
 #include "rx_definitions.h"
 
 struct s_filter_control
 {
-  uint16_t start_bin; 
-  uint16_t stop_bin; 
+  int16_t low_edge_Hz;  //pass band, relative to the tuned frequency
+  int16_t high_edge_Hz;
   int16_t fft_bin;
   int8_t noise_smoothing;
   int8_t noise_threshold;
   uint8_t spectrum_smoothing;
-  bool lower_sideband; 
-  bool upper_sideband; 
   bool capture;
   bool enable_auto_notch;
   bool enable_noise_reduction;
+  uint8_t deemphasis;   //tone controls applied to the bins, 0 is off
+  uint8_t bass;
+  uint8_t treble;
+  int16_t audio_shift_Hz; //audio frequency = |frequency + audio_shift_Hz|
 };
 
+//overlap-add filter of 2^fft_order points, each call of process_sample
+//takes fft_size/2 new samples and returns fft_size/4 (decimated by 2)
+template<uint8_t fft_order>
 class fft_filter
 {
 
+  static const uint16_t fft_size = 1u << fft_order;
+  static const uint16_t new_fft_size = fft_size / 2u;
+
   int16_t last_input_real[fft_size/2u];
   int16_t last_input_imag[fft_size/2u];
-  int16_t last_output_real[new_fft_size/2u];
-  int16_t last_output_imag[new_fft_size/2u];
-  int32_t positive_noise_estimate[new_fft_size/2u];
-  int16_t positive_signal_estimate[new_fft_size/2u];
-  int32_t negative_noise_estimate[new_fft_size/2u];
-  int16_t negative_signal_estimate[new_fft_size/2u];
+  int16_t work_real[2][fft_size];
+  int16_t work_imag[2][fft_size];
+  uint8_t work_index = 0;
+  noise_floor<new_fft_size> noise_floors;
   int32_t window[fft_size];
+  cic_corrections<fft_order> cic;
+
+  //gain (x256) of each bin of the decimated spectrum, combining the pass
+  //band, tone controls and CIC correction. The bins with a non-zero gain each
+  //side of DC are also kept.
+  struct s_mask
+  {
+    uint16_t gain[new_fft_size];
+    uint16_t upper_first_bin, upper_last_bin;
+    uint16_t lower_first_bin, lower_last_bin;
+    bool upper_active, lower_active;
+  };
+
+  //set_mask builds the mask between blocks, on core 1 with process_sample
+  s_mask mask;
+  void build_mask(const s_filter_control &filter_control, s_mask &new_mask);
+
+  //raised cosine edge of the pass band (x2^15), at 1Hz steps
+  static const uint16_t taper_Hz = 150u;
+  uint16_t taper[taper_Hz + 1u];
+  tone_control_gains tone_gains;
+  uint32_t taper_gain(int32_t frequency_Hz_x256, int16_t low_edge_Hz, int16_t high_edge_Hz) const;
+
+  //sum of the signal and noise floor magnitudes across the pass band,
+  //weighted by the filter response, in the last block
+  uint32_t passband_signal = 0;
+  uint32_t passband_noise = 0;
+
+  //auto notch, the strongest peaks of each block and the carriers that they
+  //have been confirmed as, with the depth (x256) of the notch on each
+  static const uint8_t max_notches = 4;
+  struct s_peak
+  {
+    uint16_t magnitude;
+    uint16_t bin;
+  };
+  struct s_notch
+  {
+    uint16_t bin;
+    uint8_t confirm_count;
+    uint16_t depth;
+    bool active;
+  };
+  s_peak peaks[max_notches];
+  s_notch notches[max_notches] = {};
+  void find_peak(uint16_t magnitude, uint16_t bin);
+  void update_notches(bool enable_auto_notch);
+  void apply_notches(int16_t sample_real[], int16_t sample_imag[]);
+
   void filter_block(int16_t sample_real[], int16_t sample_imag[], s_filter_control &filter_control, int16_t capture[]);
 
   public:
@@ -60,16 +118,30 @@ class fft_filter
       last_input_real[i] = 0;
       last_input_imag[i] = 0;
     }
-    for (uint16_t i = 0; i < new_fft_size/2; i++) {
-      last_output_real[i] = 0;
-      last_output_imag[i] = 0;
-      positive_noise_estimate[i] = INT32_MAX-1;
-      positive_signal_estimate[i] = 0;
-      negative_noise_estimate[i] = INT32_MAX-1;
-      negative_signal_estimate[i] = 0;
+    for (uint16_t i = 0; i < fft_size; i++) {
+      work_real[0][i] = work_real[1][i] = 0;
+      work_imag[0][i] = work_imag[1][i] = 0;
+    }
+    for (uint16_t i = 0; i <= taper_Hz; i++) {
+      taper[i] = roundf(32768.0f * (0.5f - 0.5f * cosf((float)M_PI * i / taper_Hz)));
     }
+    mask = {};
   }
+  void set_mask(const s_filter_control &filter_control);
   void process_sample(int16_t sample_iq[], s_filter_control &filter_control, int16_t capture[]);
+  void get_passband_levels(uint32_t &signal, uint32_t &noise) const
+  {
+    signal = passband_signal;
+    noise = passband_noise;
+  }
+  const s_noise_estimate *get_noise_estimates() const
+  {
+    return noise_floors.estimates();
+  }
+  int16_t cic_correct(int16_t fft_bin, int16_t fft_offset, int16_t sample) const
+  {
+    return cic.correct(fft_bin, fft_offset, sample);
+  }
 
 };
 
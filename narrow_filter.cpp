@@ -0,0 +1,151 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: narrow_filter.cpp
+// description: multirate narrow band filter for CW
+// License: MIT
+//
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "narrow_filter.h"
+#include "pico.h"
+
+narrow_filter::narrow_filter()
+{
+  design(-25, 25);
+  read_design();
+}
+
+//the narrow filter is only used for pass bands that it can handle
+bool __not_in_flash_func(narrow_filter::suitable)(int16_t low_edge_Hz, int16_t high_edge_Hz)
+{
+  const int16_t centre_Hz = (low_edge_Hz + high_edge_Hz)/2;
+  return high_edge_Hz - low_edge_Hz < max_width_Hz && abs(centre_Hz) <= max_offset_Hz;
+}
+
+//windowed sinc, moved to the centre of the pass band. The edges are at the
+//-6dB points, like the tapered edges of the FFT filter. Runs on core 0 (from
+//flash), only one caller at a time.
+void narrow_filter::design(int16_t low_edge_Hz, int16_t high_edge_Hz)
+{
+  const uint32_t sequence = design_sequence.load(std::memory_order_relaxed) + 1;
+  std::atomic_thread_fence(std::memory_order_release);
+  s_design &new_design = published_designs[sequence & 1];
+
+  const float sample_rate = (float)audio_sample_rate / decimation;
+  const float centre_Hz = 0.5f * (low_edge_Hz + high_edge_Hz);
+  const float half_width_Hz = 0.5f * (high_edge_Hz - low_edge_Hz);
+
+  float response[num_taps];
+  float dc_gain = 0.0f;
+  for(uint16_t n = 0; n < num_taps; ++n)
+  {
+    const float t = n - 0.5f * (num_taps - 1);
+    const float sinc = sinf(2.0f * (float)M_PI * half_width_Hz * t / sample_rate) / ((float)M_PI * t);
+    const float window = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (n + 0.5f) / num_taps);
+    response[n] = sinc * window;
+    dc_gain += response[n];
+  }
+
+  //correct the droop of the boxcar decimator and the linear interpolator at
+  //the centre of the pass band
+  const float x = (float)M_PI * centre_Hz / audio_sample_rate;
+  const float boxcar = x == 0.0f ? 1.0f : sinf(decimation * x) / (decimation * sinf(x));
+  dc_gain *= boxcar * boxcar * boxcar;
+
+  new_design.complex_coefficients = centre_Hz != 0.0f;
+  for(uint16_t n = 0; n < num_taps; ++n)
+  {
+    const float t = n - 0.5f * (num_taps - 1);
+    const float angle = 2.0f * (float)M_PI * centre_Hz * t / sample_rate;
+    const float gain = (1 << 14) * response[n] / dc_gain;
+    new_design.coefficient_real[num_taps - 1 - n] = roundf(gain * cosf(angle));
+    new_design.coefficient_imag[num_taps - 1 - n] = roundf(gain * sinf(angle));
+  }
+
+  design_sequence.store(sequence, std::memory_order_release);
+}
+
+//take a copy of the latest design and start again with empty history. If it
+//was overwritten while it was copied (two designs in quick succession), the
+//copy is only used for one block and taken again at the next.
+void __not_in_flash_func(narrow_filter::read_design)()
+{
+  const uint32_t sequence = design_sequence.load(std::memory_order_acquire);
+  if(sequence == applied_design_sequence) return;
+  active = published_designs[sequence & 1];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(design_sequence.load(std::memory_order_relaxed) != sequence) return;
+  applied_design_sequence = sequence;
+
+  for(uint16_t idx = 0; idx < 2u * num_taps; ++idx)
+  {
+    history_real[idx] = 0;
+    history_imag[idx] = 0;
+  }
+  history_index = 0;
+  sum_real = sum_imag = 0;
+  count = 0;
+  last_real = last_imag = next_real = next_imag = 0;
+}
+
+void __not_in_flash_func(narrow_filter::process_block)(int16_t iq[], uint16_t num_samples)
+{
+  read_design();
+
+  for(uint16_t idx = 0; idx < num_samples; ++idx)
+  {
+    sum_real += iq[2 * idx];
+    sum_imag += iq[2 * idx + 1];
+
+    //linear interpolation between the last two outputs, the images are more
+    //than 60dB down for signals this narrow
+    iq[2 * idx] = last_real + (((next_real - last_real) * count) >> 3);
+    iq[2 * idx + 1] = last_imag + (((next_imag - last_imag) * count) >> 3);
+
+    if(++count < decimation) continue;
+    count = 0;
+
+    //decimate, the boxcar nulls fall on each alias of the pass band
+    history_index = history_index + 1 == num_taps ? 0 : history_index + 1;
+    history_real[history_index] = history_real[history_index + num_taps] = sum_real >> 3;
+    history_imag[history_index] = history_imag[history_index + num_taps] = sum_imag >> 3;
+    sum_real = sum_imag = 0;
+
+    //FIR filter, oldest to newest
+    const int16_t *x_real = &history_real[history_index + 1];
+    const int16_t *x_imag = &history_imag[history_index + 1];
+    int32_t y_real = 0, y_imag = 0;
+    const int16_t *coefficient_real = active.coefficient_real;
+    const int16_t *coefficient_imag = active.coefficient_imag;
+    if(active.complex_coefficients)
+    {
+      for(uint16_t tap = 0; tap < num_taps; ++tap)
+      {
+        y_real += x_real[tap] * coefficient_real[tap] - x_imag[tap] * coefficient_imag[tap];
+        y_imag += x_real[tap] * coefficient_imag[tap] + x_imag[tap] * coefficient_real[tap];
+      }
+    }
+    else
+    {
+      for(uint16_t tap = 0; tap < num_taps; ++tap)
+      {
+        y_real += x_real[tap] * coefficient_real[tap];
+        y_imag += x_imag[tap] * coefficient_real[tap];
+      }
+    }
+
+    last_real = next_real;
+    last_imag = next_imag;
+    next_real = std::max(std::min(y_real >> 14, (int32_t)INT16_MAX), (int32_t)INT16_MIN);
+    next_imag = std::max(std::min(y_imag >> 14, (int32_t)INT16_MAX), (int32_t)INT16_MIN);
+  }
+}
@@ -0,0 +1,74 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: narrow_filter.h
+// description: multirate narrow band filter for CW
+// License: MIT
+//
+
+#ifndef NARROW_FILTER_H
+#define NARROW_FILTER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include "rx_definitions.h"
+
+//The FFT filter can't be sharper than its bins (117Hz at 256 points). For
+//narrow CW filters, the output of the FFT filter is decimated by 8 (to
+//1875Hz), filtered by a FIR filter that gives a ~45Hz transition band, and
+//interpolated back to the audio sample rate. The FFT filter removes anything
+//that would alias. The images left by the linear interpolation grow as the
+//pass band moves away from 0Hz, so it must be centred within max_offset_Hz.
+//The taps are designed on core 0 (see rx::tune) and handed to core 1 through
+//alternate buffers, process_block picks up the latest design.
+class narrow_filter
+{
+  public:
+  static const uint8_t decimation = 8u;
+  static const uint16_t num_taps = 128u;
+  static const uint16_t max_width_Hz = 250u;
+  static const uint16_t max_offset_Hz = 250u;
+
+  //widening of the FFT filter so that its edges don't reach the pass band
+  static const uint16_t guard_Hz = 120u;
+
+  narrow_filter();
+  static bool suitable(int16_t low_edge_Hz, int16_t high_edge_Hz);
+  void design(int16_t low_edge_Hz, int16_t high_edge_Hz);
+  void process_block(int16_t iq[], uint16_t num_samples);
+
+  private:
+  void read_design();
+
+  //coefficients (x2^14) ordered from oldest to newest sample
+  struct s_design
+  {
+    int16_t coefficient_real[num_taps];
+    int16_t coefficient_imag[num_taps];
+    bool complex_coefficients;
+  };
+  s_design active;
+  s_design published_designs[2];
+  std::atomic<uint32_t> design_sequence{0};
+  uint32_t applied_design_sequence = 0;
+
+  //each sample is written twice, so that the last num_taps samples are
+  //always contiguous
+  int16_t history_real[2u * num_taps];
+  int16_t history_imag[2u * num_taps];
+  uint16_t history_index;
+
+  //decimator and interpolator
+  int32_t sum_real, sum_imag;
+  uint8_t count;
+  int16_t last_real, last_imag;
+  int16_t next_real, next_imag;
+};
+
+#endif
@@ -7,13 +7,14 @@
 #include <cmath>
 #include <cstdio>
 
-float nco_set_frequency(PIO pio, uint sm, float tuned_frequency, uint32_t &system_clock_frequency_out, uint8_t if_frequency_hz_over_100, uint8_t if_mode) {
+//search all possible system clocks for the one that gets closest to the
+//wanted frequency (soft-float on the M0+, this is slow)
+static s_nco_plan nco_search(double tuned_frequency, uint8_t if_frequency_hz_over_100, uint8_t if_mode) {
 
     double adjusted_frequency_up = tuned_frequency + (if_frequency_hz_over_100*100);
     double adjusted_frequency_down = tuned_frequency - (if_frequency_hz_over_100*100);
-    PLLSettings best_settings = {0};
+    s_nco_plan best_plan = {0, 0.0f, 0.0};
     double best_frequency = 1.0;
-    double best_divider = 0.0;
     double best_error = 1000000.0;
 
     for(uint8_t idx = 0; idx < num_possible_frequencies; idx++)
@@ -35,10 +36,9 @@ float nco_set_frequency(PIO pio, uint sm, float tuned_frequency, uint32_t &syste
         if(error < best_error)
         {
           best_frequency = actual_frequency;
-          best_settings = possible_frequencies[idx];
-          best_divider = nearest_divider;
+          best_plan.pll_index = idx;
+          best_plan.divider = nearest_divider;
           best_error = error;
-          system_clock_frequency_out = system_clock_frequency;
         }
       }
 
@@ -52,22 +52,82 @@ float nco_set_frequency(PIO pio, uint sm, float tuned_frequency, uint32_t &syste
         if(error < best_error)
         {
           best_frequency = actual_frequency;
-          best_settings = possible_frequencies[idx];
-          best_divider = nearest_divider;
+          best_plan.pll_index = idx;
+          best_plan.divider = nearest_divider;
           best_error = error;
-          system_clock_frequency_out = system_clock_frequency;
         }
       }
     }
 
     assert(best_error < 1000000);
+    best_plan.frequency_Hz = best_frequency/4.0;
+    return best_plan;
+}
+
+//The result of a search is cached for each 1kHz bucket, tuning back to a
+//frequency that has been visited before doesn't need another search. The
+//plan for a bucket is always worked out at the bucket centre, so it doesn't
+//depend on the tuning history.
+static const uint32_t nco_cache_bucket_Hz = 1000u;
+static const uint16_t nco_cache_size = 64u;
+
+struct s_nco_cache_entry
+{
+  bool valid;
+  uint32_t bucket;
+  s_nco_plan plan;
+};
+
+static s_nco_cache_entry nco_cache[nco_cache_size];
+static uint8_t nco_cache_if_frequency_hz_over_100 = 0;
+static uint8_t nco_cache_if_mode = 0;
+
+s_nco_plan nco_plan_frequency(double tuned_frequency, uint8_t if_frequency_hz_over_100, uint8_t if_mode) {
+
+    //results depend on the IF settings, start again if they change
+    if(if_frequency_hz_over_100 != nco_cache_if_frequency_hz_over_100 || if_mode != nco_cache_if_mode)
+    {
+      for(uint16_t idx = 0; idx < nco_cache_size; idx++) nco_cache[idx].valid = false;
+      nco_cache_if_frequency_hz_over_100 = if_frequency_hz_over_100;
+      nco_cache_if_mode = if_mode;
+    }
+
+    const uint32_t bucket = tuned_frequency/nco_cache_bucket_Hz;
+    s_nco_cache_entry &entry = nco_cache[bucket % nco_cache_size];
+    if(!entry.valid || entry.bucket != bucket)
+    {
+      const double bucket_centre = ((double)bucket + 0.5) * nco_cache_bucket_Hz;
+      entry.plan = nco_search(bucket_centre, if_frequency_hz_over_100, if_mode);
+      entry.bucket = bucket;
+      entry.valid = true;
+    }
+    return entry.plan;
+}
+
+bool nco_in_window(double offset_frequency_Hz, int16_t low_edge_Hz, int16_t high_edge_Hz, uint8_t if_frequency_hz_over_100) {
+
+    //both edges of the filter pass band must be inside the usable IF
+    if(fabs(offset_frequency_Hz + low_edge_Hz) > nco_usable_if_Hz) return false;
+    if(fabs(offset_frequency_Hz + high_edge_Hz) > nco_usable_if_Hz) return false;
+
+    const double magnitude = fabs(offset_frequency_Hz);
+
+    //when an IF is used, keep the signal well away from DC
+    if(magnitude < if_frequency_hz_over_100*50.0) return false;
+
+    return true;
+}
+
+void nco_apply_plan(PIO pio, uint sm, const s_nco_plan &plan, bool set_pll) {
+
     //adjust system clock
-    uint32_t vco_freq = (12000000 / best_settings.refdiv) * best_settings.fbdiv;
-    set_sys_clock_pll(vco_freq, best_settings.postdiv1, best_settings.postdiv2);
+    if(set_pll)
+    {
+      const PLLSettings &settings = possible_frequencies[plan.pll_index];
+      uint32_t vco_freq = (12000000 / settings.refdiv) * settings.fbdiv;
+      set_sys_clock_pll(vco_freq, settings.postdiv1, settings.postdiv2);
+    }
 
     //set pio divider
-    pio_sm_set_clkdiv(pio, sm, best_divider);
-
-    //return actual frequency
-    return best_frequency/4.0;
+    pio_sm_set_clkdiv(pio, sm, plan.divider);
 }
@@ -2,6 +2,23 @@
 #define NCO_H_
 #include "hardware/pio.h"
 
-float nco_set_frequency(PIO pio, uint sm, float tuned_frequency, uint32_t &system_clock_frequency_out, uint8_t if_frequency_hz_over_100, uint8_t if_mode);
+//usable IF either side of the NCO frequency, the IQ sample rate gives +/-15kHz,
+//less a guard for the roll off at the band edge, the whole filter pass band
+//must stay inside
+const double nco_usable_if_Hz = 14e3;
+
+//system clock (PLL) and PIO divider that give a particular NCO frequency
+struct s_nco_plan
+{
+  uint8_t pll_index;
+  float divider;
+  double frequency_Hz;
+};
+
+//tuning planner, small moves stay on the current NCO frequency and only
+//change the offset, larger moves use a (cached) search of the PLL settings
+bool nco_in_window(double offset_frequency_Hz, int16_t low_edge_Hz, int16_t high_edge_Hz, uint8_t if_frequency_hz_over_100);
+s_nco_plan nco_plan_frequency(double tuned_frequency, uint8_t if_frequency_hz_over_100, uint8_t if_mode);
+void nco_apply_plan(PIO pio, uint sm, const s_nco_plan &plan, bool set_pll);
 
 #endif
@@ -0,0 +1,71 @@
+#include "noise_floor.h"
+
+#include <cstdint>
+#include <algorithm>
+
+#include "rx_definitions.h"
+#include "pico.h"
+
+template<uint16_t num_bins>
+noise_floor<num_bins>::noise_floor()
+{
+  for(uint16_t bin = 0; bin < num_bins; ++bin)
+  {
+    estimate[bin] = {0, UINT16_MAX};
+    sub_window_minimum[bin] = UINT16_MAX;
+    window_minimum[bin] = UINT16_MAX;
+    for(uint8_t sub_window = 0; sub_window < num_sub_windows; ++sub_window)
+    {
+      sub_window_minima[sub_window][bin] = UINT16_MAX;
+    }
+  }
+}
+
+template<uint16_t num_bins>
+void __not_in_flash_func(noise_floor<num_bins>::end_block)(int8_t noise_smoothing)
+{
+  //mean/minimum of the smoothed magnitude of noise alone, for each window
+  //length (x256), checked by simulations/test_noise_floor.cpp
+  static const uint16_t __not_in_flash("noise_floor_bias") biases[max_noise_smoothing + 1] = {
+    335, 355, 373, 390, 407
+  };
+
+  //each block holds num_bins new (complex) samples, 1/16s sub-windows
+  static const uint16_t base_sub_window_blocks = std::max(adc_sample_rate / (cic_decimation_rate * num_bins * 16u), (uint32_t)1);
+
+  if(warmup)
+  {
+    //the smoothed magnitudes start from zero, don't let them set the minimum
+    warmup--;
+    return;
+  }
+
+  noise_smoothing = std::min(std::max(noise_smoothing, (int8_t)0), (int8_t)max_noise_smoothing);
+  bias = biases[noise_smoothing];
+
+  if(++block_count < (base_sub_window_blocks << noise_smoothing)) return;
+  block_count = 0;
+
+  //end of sub-window, the oldest one drops out of the window
+  for(uint16_t bin = 0; bin < num_bins; ++bin)
+  {
+    sub_window_minima[sub_window][bin] = sub_window_minimum[bin];
+    sub_window_minimum[bin] = UINT16_MAX;
+    uint16_t minimum = UINT16_MAX;
+    for(uint8_t idx = 0; idx < num_sub_windows; ++idx)
+    {
+      minimum = std::min(minimum, sub_window_minima[idx][bin]);
+    }
+    window_minimum[bin] = minimum;
+  }
+  sub_window = (sub_window + 1) % num_sub_windows;
+}
+
+#ifdef SIMULATION
+template class noise_floor<64>;
+template class noise_floor<128>;
+template class noise_floor<256>;
+template class noise_floor<512>;
+#else
+template class noise_floor<new_fft_size>;
+#endif
@@ -0,0 +1,56 @@
+#ifndef __NOISE_FLOOR_H__
+#define __NOISE_FLOOR_H__
+
+#include <cstdint>
+#include <algorithm>
+
+//smoothed signal and noise floor magnitudes of one bin
+struct s_noise_estimate
+{
+  uint16_t signal;
+  uint16_t noise;
+};
+
+//minimum statistics noise floor of each bin of a spectrum. The smoothed
+//magnitude of each bin is tracked, and its minimum over a window of
+//num_sub_windows sub-windows, corrected for the bias of the minimum, gives
+//the noise floor. Speech and CW leave gaps that reach the floor, but a steady
+//carrier raises it. The window lasts from 0.25s (noise_smoothing 0) to 4s
+//(noise_smoothing 4), one step for each Noise Estimation setting.
+template<uint16_t num_bins>
+class noise_floor
+{
+  static const uint8_t magnitude_smoothing = 3;
+  static const uint8_t num_sub_windows = 4;
+  static const uint8_t max_noise_smoothing = 4;
+  static const uint8_t warmup_blocks = 1u << magnitude_smoothing;
+
+  s_noise_estimate estimate[num_bins];
+  uint16_t sub_window_minimum[num_bins];
+  uint16_t window_minimum[num_bins];
+  uint16_t sub_window_minima[num_sub_windows][num_bins];
+  uint16_t block_count = 0;
+  uint8_t sub_window = 0;
+  uint8_t warmup = warmup_blocks;
+  uint16_t bias = 256;
+
+  public:
+  noise_floor();
+
+  //called for every bin of each block, then end_block
+  void update(uint16_t bin, uint16_t magnitude)
+  {
+    s_noise_estimate &e = estimate[bin];
+    e.signal = (((int32_t)e.signal << magnitude_smoothing) + (magnitude - e.signal)) >> magnitude_smoothing;
+    if(warmup) return;
+    sub_window_minimum[bin] = std::min(sub_window_minimum[bin], e.signal);
+    const uint32_t minimum = std::min(sub_window_minimum[bin], window_minimum[bin]);
+    e.noise = std::min((minimum * bias) >> 8, (uint32_t)UINT16_MAX);
+  }
+  void end_block(int8_t noise_smoothing);
+
+  const s_noise_estimate *estimates() const { return estimate; }
+  const s_noise_estimate &operator[](uint16_t bin) const { return estimate[bin]; }
+};
+
+#endif
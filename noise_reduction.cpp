@@ -2,10 +2,10 @@
 #include <algorithm>
 #include <iostream>
 
-#include "utils.h"
+#include "pico.h"
 #include "noise_reduction.h"
+#include "utils.h"
 
-const int8_t magnitude_smoothing = 3;
 const uint8_t fraction_bits = 15u;
 const int32_t scaling = (1<<fraction_bits)-1;
 
@@ -16,7 +16,8 @@ const uint32_t adaptive_threshold_high = (scaling*6);
 const uint32_t snr_lin_low = 0.5623413251903491 * scaling;
 const uint32_t snr_lin_high = 10.0 * scaling;
 const uint32_t snr_lut_scale = 818u;
-static const uint32_t adaptive_threshold_lut[] = {
+const uint32_t snr_lut_reciprocal = (1u<<22)/snr_lut_scale + 1; //x/818 ~= (x*5128)>>22
+static const uint32_t __not_in_flash("adaptive_threshold_lut") adaptive_threshold_lut[] = {
     196602, 194126, 191753, 189476, 187285, 185176, 183143, 181179, 179281,
     177445, 175665, 173940, 172265, 170639, 169057, 167518, 166020, 164560,
     163137, 161748, 160393, 159069, 157775, 156510, 155272, 154061, 152874,
@@ -60,45 +61,47 @@ static const uint32_t adaptive_threshold_lut[] = {
     35314,  35166,  35018,  34870,  34722,  34575,  34428,  34282,  34136,
     33991,  33845,  33701,  33556,  33412,  33268,  33125,  32982,  32839,
 };
+//snr_lin_high just reaches past the last entry
+static const uint16_t adaptive_threshold_lut_last = sizeof(adaptive_threshold_lut)/sizeof(adaptive_threshold_lut[0]) - 1;
 
-
-void noise_reduction(int16_t i[], int16_t q[], int32_t noise_estimate[], int16_t signal_estimate[], uint16_t start, uint16_t stop, const int8_t noise_smoothing, const int8_t threshold)
+void __not_in_flash_func(noise_reduction)(int16_t i[], int16_t q[], const s_noise_estimate estimate[], uint16_t start, uint16_t stop, const int8_t threshold)
 {
     for(uint16_t idx = start; idx <= stop; ++idx)
     {
 
-      const int32_t magnitude = rectangular_2_magnitude(i[idx], q[idx]);
-      int32_t signal_level = signal_estimate[idx];
-      int32_t noise_level = noise_estimate[idx];
-
-      signal_level = ((signal_level << magnitude_smoothing) + (magnitude - signal_level)) >> magnitude_smoothing;
-      noise_level = std::min(noise_level+1, signal_level << noise_smoothing);
-
-      uint32_t snr = (signal_level * scaling) / (noise_level>>noise_smoothing);
+      const uint32_t signal_level = estimate[idx].signal;
+      //noise estimate can round to zero, avoid divide by zero
+      const uint32_t noise = std::max(estimate[idx].noise, (uint16_t)1);
 
+      //every threshold is at least 1, so no signal is left once the noise
+      //floor reaches the signal
+      int32_t gain = 0;
+      if(signal_level > noise)
+      {
+        uint8_t shift;
 
-      //Use adaptive threshold by mryndzionek
-      uint32_t adaptive_threshold = threshold*scaling;
-      if(threshold == 0){ //0 enables adaptive mode
-        if (snr < snr_lin_low) {
-          adaptive_threshold = adaptive_threshold_high;
-        } else if (snr > snr_lin_high) {
-          adaptive_threshold = adaptive_threshold_low;
-        } else {
-          uint16_t idx = (snr - snr_lin_low) / snr_lut_scale;
-          adaptive_threshold = adaptive_threshold_lut[idx];
+        //Use adaptive threshold by mryndzionek
+        uint32_t adaptive_threshold = threshold*scaling;
+        if(threshold == 0){ //0 enables adaptive mode
+          //snr = signal_level * scaling / noise
+          const uint32_t snr = (signal_level * reciprocal(noise, shift)) >> (shift - fraction_bits);
+          if (snr < snr_lin_low) {
+            adaptive_threshold = adaptive_threshold_high;
+          } else if (snr > snr_lin_high) {
+            adaptive_threshold = adaptive_threshold_low;
+          } else {
+            const uint16_t lut_idx = ((snr - snr_lin_low) * snr_lut_reciprocal) >> 22;
+            adaptive_threshold = adaptive_threshold_lut[std::min(lut_idx, adaptive_threshold_lut_last)];
+          }
         }
-      }
 
-      int32_t gain = 0;
-      if(signal_level > 0)
-      {
-        gain = scaling-(adaptive_threshold*(noise_level>>noise_smoothing)/signal_level);
+        //noise/signal_level with 13 fraction bits, so that the product with
+        //the threshold (up to 6 * scaling) fits in 32 bits
+        const uint32_t noise_ratio = (noise * reciprocal(signal_level, shift)) >> (shift - 13);
+        gain = scaling - ((adaptive_threshold * noise_ratio) >> 13);
         gain = std::min(std::max(gain, (int32_t)0), scaling);
-      } 
-      
-      signal_estimate[idx] = signal_level;
-      noise_estimate[idx] = noise_level;
+      }
+
       i[idx] = (i[idx]*gain)>>fraction_bits;
       q[idx] = (q[idx]*gain)>>fraction_bits;
 
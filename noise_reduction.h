@@ -2,6 +2,8 @@
 #define __NOISE_REDUCTION_H__
 
 #include <cstdint>
-void noise_reduction(int16_t i[], int16_t q[], int32_t noise_estimate[], int16_t signal_estimate[], uint16_t start, uint16_t stop, const int8_t noise_smoothing, const int8_t threshold);
+#include "noise_floor.h"
+
+void noise_reduction(int16_t i[], int16_t q[], const s_noise_estimate estimate[], uint16_t start, uint16_t stop, const int8_t threshold);
 
 #endif
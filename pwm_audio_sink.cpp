@@ -28,7 +28,7 @@ const uint32_t ramp_samples = 500;
 static uint32_t ramp=ramp_samples;
 static bool ground = false;
 
-static void interpolate(int16_t sample, int16_t pwm_samples[], int16_t gain) {
+static void __not_in_flash_func(interpolate)(int16_t sample, int16_t pwm_samples[], int16_t gain) {
 
   // digital volume control
   sample = ((int32_t)sample * gain) >> 8;
@@ -84,7 +84,7 @@ void pwm_audio_sink_init(void) {
                           DREQ_PWM_WRAP0 + audio_pwm_slice_num);
 }
 
-void pwm_audio_sink_start(void) {
+void __not_in_flash_func(pwm_audio_sink_start)(void) {
   dma_channel_configure(pwm_dma_ping, &audio_ping_cfg,
                         &pwm_hw->slice[audio_pwm_slice_num].cc, ping_audio,
                         NUM_OUT_SAMPLES, false);
@@ -93,12 +93,18 @@ void pwm_audio_sink_start(void) {
                         NUM_OUT_SAMPLES, false);
 }
 
-void pwm_audio_sink_stop(void) {
-  dma_channel_cleanup(pwm_dma_ping);
-  dma_channel_cleanup(pwm_dma_pong);
+void __not_in_flash_func(pwm_audio_sink_stop)(void) {
+  //same as dma_channel_cleanup, but runs from RAM
+  const int channels[] = {pwm_dma_ping, pwm_dma_pong};
+  for (int channel : channels) {
+    hw_write_masked(&dma_hw->ch[channel].al1_ctrl, (channel << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB), DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS | DMA_CH0_CTRL_TRIG_EN_BITS);
+    dma_channel_set_irq0_enabled(channel, false);
+    dma_channel_abort(channel);
+    dma_hw->intr = 1u << channel;
+  }
 }
 
-uint32_t pwm_audio_sink_push(int16_t samples[PWM_AUDIO_NUM_SAMPLES], int16_t gain) {
+uint32_t __not_in_flash_func(pwm_audio_sink_push)(int16_t samples[PWM_AUDIO_NUM_SAMPLES], int16_t gain) {
   static bool toggle = false;
   uint32_t time;
 
@@ -22,18 +22,37 @@ static uint8_t usb_buf[USB_BUF_SIZE];
 //buffers and dma for ADC
 int rx::adc_dma_ping;
 int rx::adc_dma_pong;
+int rx::adc_dma_rrobin_set;
+int rx::adc_dma_housekeeping;
+int rx::adc_dma_rrobin_clear;
 dma_channel_config rx::ping_cfg;
 dma_channel_config rx::pong_cfg;
+dma_channel_config rx::rrobin_set_cfg;
+dma_channel_config rx::housekeeping_cfg;
+dma_channel_config rx::rrobin_clear_cfg;
 uint16_t rx::ping_samples[adc_block_size];
 uint16_t rx::pong_samples[adc_block_size];
 
+//The battery (3) and temperature (4) channels are added to the ADC
+//round-robin for one cycle at the start of each pong block. The DMA chain
+//ping -> rrobin_set -> housekeeping -> rrobin_clear -> pong switches them in
+//and out again at exact sample positions, without CPU involvement:
+//
+//  ping: ... I Q | housekeeping: I Q B T | pong: I Q I Q ...
+//
+//The B and T slots are replaced with interpolated I/Q, so the I/Q sample
+//rate and block timing are unchanged.
+static const uint32_t __not_in_flash("adc") housekeeping_rrobin = ((1u << 3) | (1u << 4)) << ADC_CS_RROBIN_LSB;
+static const uint16_t housekeeping_samples = 4;
+
 bool rx::audio_running;
+volatile uint32_t rx::blocks_captured;
 
 //dma for capture
 int rx::capture_dma;
 dma_channel_config rx::capture_cfg;
 
-void rx::dma_handler() {
+void __not_in_flash_func(rx::dma_handler)() {
 
 
     // adc ping             ####    ####
@@ -45,12 +64,15 @@ void rx::dma_handler() {
     {
       dma_channel_set_write_addr(adc_dma_ping, ping_samples, false);
       dma_hw->ints0 = 1u << adc_dma_ping;
+      blocks_captured++;
     }
 
     if(dma_hw->ints0 & (1u << adc_dma_pong))
     {
-      dma_channel_set_write_addr(adc_dma_pong, pong_samples, false);
+      dma_channel_set_write_addr(adc_dma_housekeeping, pong_samples, false);
+      dma_channel_set_write_addr(adc_dma_pong, pong_samples + housekeeping_samples, false);
       dma_hw->ints0 = 1u << adc_dma_pong;
+      blocks_captured++;
     }
 
 }
@@ -70,6 +92,19 @@ void rx::tune()
 
   if(sem_try_acquire(&settings_semaphore))
   {
+    //the pass band is needed to design the narrow CW filter, and to check
+    //that it fits in the IF
+    int16_t low_edge_Hz, high_edge_Hz;
+    rx_dsp::get_passband_Hz(settings_to_apply.mode, settings_to_apply.bandwidth,
+      settings_to_apply.filter_width_Hz, settings_to_apply.if_shift_Hz, low_edge_Hz, high_edge_Hz);
+    const bool passband_changed = (low_edge_Hz != passband_low_Hz) || (high_edge_Hz != passband_high_Hz);
+    if(passband_changed)
+    {
+      passband_low_Hz = low_edge_Hz;
+      passband_high_Hz = high_edge_Hz;
+      rx_dsp_inst.design_narrow_filter(low_edge_Hz, high_edge_Hz);
+    }
+
     if(settings_to_apply.enable_external_nco)
     {
       //disable internal nco
@@ -113,7 +148,6 @@ void rx::tune()
         if_frequency_hz_over_100 = settings_to_apply.if_frequency_hz_over_100;
         nco_frequency_Hz = external_nco.set_frequency_hz(adjusted_tuned_frequency_Hz + ((uint16_t)if_frequency_hz_over_100*100));
         offset_frequency_Hz = adjusted_tuned_frequency_Hz - nco_frequency_Hz;
-        rx_dsp_inst.set_frequency_offset_Hz(offset_frequency_Hz);
       }
     }
     else
@@ -135,13 +169,27 @@ void rx::tune()
         gpio_set_dir(PIN_NCO_2, GPIO_OUT);
         pio_sm_set_enabled(pio, sm, true);
         internal_nco_active = true;
+
+        //the external nco fixes the clock, so the nco needs a full retune
+        nco_pll_index = 0;
+        nco_retune = true;
       }
 
+      //a wider filter may no longer fit in the IF of the current nco frequency
       if((tuned_frequency_Hz != settings_to_apply.tuned_frequency_Hz) || 
+         passband_changed ||
          (ppm != settings_to_apply.ppm) ||
          (if_mode != settings_to_apply.if_mode) ||
-         (if_frequency_hz_over_100 != settings_to_apply.if_frequency_hz_over_100))
+         (if_frequency_hz_over_100 != settings_to_apply.if_frequency_hz_over_100) ||
+         nco_retune)
       {
+        //a change of IF needs the nco to move
+        if((if_mode != settings_to_apply.if_mode) ||
+           (if_frequency_hz_over_100 != settings_to_apply.if_frequency_hz_over_100))
+        {
+          nco_retune = true;
+        }
+
         //apply frequency
         tuned_frequency_Hz = settings_to_apply.tuned_frequency_Hz;
         ppm = settings_to_apply.ppm;
@@ -150,18 +198,43 @@ void rx::tune()
         double adjusted_tuned_frequency_Hz = tuned_frequency_Hz * 1e6/(1e6+settings_to_apply.ppm);
         if_mode = settings_to_apply.if_mode;
         if_frequency_hz_over_100 = settings_to_apply.if_frequency_hz_over_100;
-        
-        disable_pwm(settings_to_apply.tuning_option);
 
-        nco_frequency_Hz = nco_set_frequency(pio, sm, adjusted_tuned_frequency_Hz, system_clock_rate, if_frequency_hz_over_100, if_mode);
-        offset_frequency_Hz = adjusted_tuned_frequency_Hz - nco_frequency_Hz;
-        pwm_audio_sink_update_pwm_max((system_clock_rate/pwm_audio_sample_rate)-1);
-        rx_dsp_inst.set_frequency_offset_Hz(offset_frequency_Hz);
+        //fast path, the new frequency is still within the IF of the current
+        //nco frequency, only the offset in the DSP needs to change
+        const double new_offset_frequency_Hz = adjusted_tuned_frequency_Hz - nco_frequency_Hz;
+        if(!nco_retune && nco_in_window(new_offset_frequency_Hz, passband_low_Hz, passband_high_Hz, if_frequency_hz_over_100))
+        {
+          offset_frequency_Hz = new_offset_frequency_Hz;
+        }
+        else
+        {
+          //only a change of system clock disturbs the audio pwm
+          const s_nco_plan plan = nco_plan_frequency(adjusted_tuned_frequency_Hz, if_frequency_hz_over_100, if_mode);
+          const bool set_pll = plan.pll_index != nco_pll_index;
 
-        enable_pwm(settings_to_apply.tuning_option);
+          if(set_pll) disable_pwm(settings_to_apply.tuning_option);
+
+          nco_apply_plan(pio, sm, plan, set_pll);
+          nco_pll_index = plan.pll_index;
+          nco_frequency_Hz = plan.frequency_Hz;
+          system_clock_rate = possible_frequencies[plan.pll_index].frequency;
+          offset_frequency_Hz = adjusted_tuned_frequency_Hz - nco_frequency_Hz;
+          pwm_audio_sink_update_pwm_max((system_clock_rate/pwm_audio_sample_rate)-1);
+
+          if(set_pll) enable_pwm(settings_to_apply.tuning_option);
+          nco_retune = false;
+        }
       }
     }
 
+    //the offset is applied by core 1 at the next block boundary, with the
+    //rest of the settings
+    if(settings_to_apply.offset_frequency_Hz != offset_frequency_Hz)
+    {
+      settings_to_apply.offset_frequency_Hz = offset_frequency_Hz;
+      settings_snapshot_inst.publish(settings_to_apply);
+    }
+
     sem_release(&settings_semaphore);
   }
 }
@@ -169,10 +242,16 @@ void rx::tune()
 
 void rx::release()
 {
+  //publish a snapshot of the new settings for core 1
+  if(settings_changed)
+  {
+    settings_snapshot_inst.publish(settings_to_apply);
+    settings_changed = false;
+  }
   sem_release(&settings_semaphore);
 }
 
-void rx::update_status()
+void __not_in_flash_func(rx::update_status)()
 {
 
    const bool sem_acquired = sem_try_acquire(&settings_semaphore);
@@ -182,6 +261,7 @@ void rx::update_status()
 
      //update status
      status.signal_strength_dBm = rx_dsp_inst.get_signal_strength_dBm();
+     status.snr_dB = rx_dsp_inst.get_snr_dB();
      status.busy_time = busy_time;
      status.battery = battery;
      status.temp = temp;
@@ -190,132 +270,104 @@ void rx::update_status()
      avg_level = (avg_level - (avg_level >> 2)) + (ring_buffer_get_num_bytes(&usb_ring_buffer) >> 2);
      status.usb_buf_level = 100 * avg_level / USB_BUF_SIZE;
      status.tuning_offset_Hz = rx_dsp_inst.get_tuning_offset_Hz();
+     status.restarts_avoided = settings_snapshot_inst.get_restarts_avoided();
+     status.deadline_misses = deadline_misses;
+     status.dsp_load = (100u * load_average) >> 8;
+     status.shed_features = rx_dsp_inst.get_shed_features();
 
      sem_release(&settings_semaphore);
    }
 }
 
-void rx::apply_settings()
+void __not_in_flash_func(rx::set_band)(const rx_settings &settings)
 {
-   if(sem_try_acquire(&settings_semaphore))
-   {
-
-      if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_7_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 0);
-        gpio_put(PIN_BAND_1, 0);
-        gpio_put(PIN_BAND_2, 0);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_6_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 1);
-        gpio_put(PIN_BAND_1, 0);
-        gpio_put(PIN_BAND_2, 0);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_5_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 0);
-        gpio_put(PIN_BAND_1, 1);
-        gpio_put(PIN_BAND_2, 0);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_4_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 1);
-        gpio_put(PIN_BAND_1, 1);
-        gpio_put(PIN_BAND_2, 0);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_3_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 0);
-        gpio_put(PIN_BAND_1, 0);
-        gpio_put(PIN_BAND_2, 1);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_2_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 1);
-        gpio_put(PIN_BAND_1, 0);
-        gpio_put(PIN_BAND_2, 1);
-      }
-      else if(settings_to_apply.tuned_frequency_Hz > (settings_to_apply.band_1_limit * 125000))
-      {
-        gpio_put(PIN_BAND_0, 0);
-        gpio_put(PIN_BAND_1, 1);
-        gpio_put(PIN_BAND_2, 1);
-      }
-      else
-      {
-        gpio_put(PIN_BAND_0, 1);
-        gpio_put(PIN_BAND_1, 1);
-        gpio_put(PIN_BAND_2, 1);
-      }
-
-
-      //apply frequency offset
-      rx_dsp_inst.set_frequency_offset_Hz(offset_frequency_Hz);
-
-      //apply CW sidetone
-      rx_dsp_inst.set_cw_sidetone_Hz(settings_to_apply.cw_sidetone_Hz);
-
-      //apply gain calibration
-      rx_dsp_inst.set_gain_cal_dB(settings_to_apply.gain_cal);
-
-      //apply AGC control
-      rx_dsp_inst.set_agc_control(settings_to_apply.agc_setting, settings_to_apply.agc_gain);
-
-      //apply Automatic Notch Filter
-      rx_dsp_inst.set_auto_notch(settings_to_apply.enable_auto_notch);
-
-      //apply Spectrum Smoothing
-      rx_dsp_inst.set_spectrum_smoothing(settings_to_apply.spectrum_smoothing);
-
-      //apply Noise Reduction
-      rx_dsp_inst.set_noise_reduction(settings_to_apply.enable_noise_reduction, settings_to_apply.noise_estimation, settings_to_apply.noise_threshold);
-
-      //apply mode
-      rx_dsp_inst.set_mode(settings_to_apply.mode, settings_to_apply.bandwidth);
-
-
-      //apply volume
-      static const int16_t gain[] = {
-        0,   // 0 = 0/256 -infdB
-        16,  // 1 = 16/256 -24dB
-        23,  // 2 = 23/256 -21dB
-        32,  // 3 = 32/256 -18dB
-        45,  // 4 = 45/256 -15dB
-        64,  // 5 = 64/256 -12dB
-        90,  // 6 = 90/256  -9dB
-        128, // 7 = 128/256 -6dB
-        180, // 8 = 180/256 -3dB
-        256  // 9 = 256/256  0dB
-      };
-      gain_numerator = gain[settings_to_apply.volume];
-
-      //apply deemphasis
-      rx_dsp_inst.set_deemphasis(settings_to_apply.deemphasis);
-
-      //apply treble
-      rx_dsp_inst.set_treble(settings_to_apply.treble);
-    
-      //apply bass
-      rx_dsp_inst.set_bass(settings_to_apply.bass);
-
-      //apply impulse blanker threshold
-      rx_dsp_inst.set_impulse_threshold(settings_to_apply.impulse_threshold);
+  if(settings.tuned_frequency_Hz > (settings.band_7_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 0);
+    gpio_put(PIN_BAND_1, 0);
+    gpio_put(PIN_BAND_2, 0);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_6_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 1);
+    gpio_put(PIN_BAND_1, 0);
+    gpio_put(PIN_BAND_2, 0);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_5_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 0);
+    gpio_put(PIN_BAND_1, 1);
+    gpio_put(PIN_BAND_2, 0);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_4_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 1);
+    gpio_put(PIN_BAND_1, 1);
+    gpio_put(PIN_BAND_2, 0);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_3_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 0);
+    gpio_put(PIN_BAND_1, 0);
+    gpio_put(PIN_BAND_2, 1);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_2_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 1);
+    gpio_put(PIN_BAND_1, 0);
+    gpio_put(PIN_BAND_2, 1);
+  }
+  else if(settings.tuned_frequency_Hz > (settings.band_1_limit * 125000))
+  {
+    gpio_put(PIN_BAND_0, 0);
+    gpio_put(PIN_BAND_1, 1);
+    gpio_put(PIN_BAND_2, 1);
+  }
+  else
+  {
+    gpio_put(PIN_BAND_0, 1);
+    gpio_put(PIN_BAND_1, 1);
+    gpio_put(PIN_BAND_2, 1);
+  }
+}
 
-      //apply squelch
-      rx_dsp_inst.set_squelch(settings_to_apply.squelch_threshold, settings_to_apply.squelch_timeout);
+//apply a settings snapshot, only fields that differ from the last applied
+//snapshot are written (unless apply_all). Returns true if the change can't be
+//applied while streaming and the receiver needs to be restarted.
+bool __not_in_flash_func(rx::apply_settings)(const rx_settings &settings, bool apply_all)
+{
+  const rx_settings &old = settings_snapshot_inst.get_applied();
+  #define CHANGED(field) (apply_all || (settings.field != old.field))
 
-      //apply swap iq
-      rx_dsp_inst.set_swap_iq(settings_to_apply.swap_iq);
+  if(CHANGED(tuned_frequency_Hz) || CHANGED(band_1_limit) || CHANGED(band_2_limit) ||
+     CHANGED(band_3_limit) || CHANGED(band_4_limit) || CHANGED(band_5_limit) ||
+     CHANGED(band_6_limit) || CHANGED(band_7_limit))
+  {
+    set_band(settings);
+  }
 
-      //apply iq imbalance correction
-      rx_dsp_inst.set_iq_correction(settings_to_apply.iq_correction);
+  //apply volume
+  if(CHANGED(volume))
+  {
+    static const int16_t __not_in_flash("volume_gain") gain[] = {
+      0,   // 0 = 0/256 -infdB
+      16,  // 1 = 16/256 -24dB
+      23,  // 2 = 23/256 -21dB
+      32,  // 3 = 32/256 -18dB
+      45,  // 4 = 45/256 -15dB
+      64,  // 5 = 64/256 -12dB
+      90,  // 6 = 90/256  -9dB
+      128, // 7 = 128/256 -6dB
+      180, // 8 = 180/256 -3dB
+      256  // 9 = 256/256  0dB
+    };
+    gain_numerator = gain[settings.volume];
+  }
 
-      stream_raw_iq = settings_to_apply.stream_raw_iq;
+  stream_raw_iq = settings.stream_raw_iq;
 
-      settings_changed = false;
-      sem_release(&settings_semaphore);
-   }
+  #undef CHANGED
+  return apply_dsp_settings(rx_dsp_inst, settings, old, apply_all);
 }
 
 void rx::get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom)
@@ -392,14 +444,20 @@ rx::rx(rx_settings & settings_to_apply, rx_status & status) : settings_to_apply(
     // Configure DMA for ADC transfers
     adc_dma_ping = dma_claim_unused_channel(true);
     adc_dma_pong = dma_claim_unused_channel(true);
+    adc_dma_rrobin_set = dma_claim_unused_channel(true);
+    adc_dma_housekeeping = dma_claim_unused_channel(true);
+    adc_dma_rrobin_clear = dma_claim_unused_channel(true);
     ping_cfg = dma_channel_get_default_config(adc_dma_ping);
     pong_cfg = dma_channel_get_default_config(adc_dma_pong);
+    rrobin_set_cfg = dma_channel_get_default_config(adc_dma_rrobin_set);
+    housekeeping_cfg = dma_channel_get_default_config(adc_dma_housekeeping);
+    rrobin_clear_cfg = dma_channel_get_default_config(adc_dma_rrobin_clear);
 
     channel_config_set_transfer_data_size(&ping_cfg, DMA_SIZE_16);
     channel_config_set_read_increment(&ping_cfg, false);
     channel_config_set_write_increment(&ping_cfg, true);
     channel_config_set_dreq(&ping_cfg, DREQ_ADC);// Pace transfers based on availability of ADC samples
-    channel_config_set_chain_to(&ping_cfg, adc_dma_pong);
+    channel_config_set_chain_to(&ping_cfg, adc_dma_rrobin_set);
 
     channel_config_set_transfer_data_size(&pong_cfg, DMA_SIZE_16);
     channel_config_set_read_increment(&pong_cfg, false);
@@ -407,6 +465,23 @@ rx::rx(rx_settings & settings_to_apply, rx_status & status) : settings_to_apply(
     channel_config_set_dreq(&pong_cfg, DREQ_ADC);// Pace transfers based on availability of ADC samples
     channel_config_set_chain_to(&pong_cfg, adc_dma_ping);
 
+    //housekeeping, atomic set/clear of the round-robin bits leaves AINSEL alone
+    channel_config_set_transfer_data_size(&rrobin_set_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&rrobin_set_cfg, false);
+    channel_config_set_write_increment(&rrobin_set_cfg, false);
+    channel_config_set_chain_to(&rrobin_set_cfg, adc_dma_housekeeping);
+
+    channel_config_set_transfer_data_size(&housekeeping_cfg, DMA_SIZE_16);
+    channel_config_set_read_increment(&housekeeping_cfg, false);
+    channel_config_set_write_increment(&housekeeping_cfg, true);
+    channel_config_set_dreq(&housekeeping_cfg, DREQ_ADC);
+    channel_config_set_chain_to(&housekeeping_cfg, adc_dma_rrobin_clear);
+
+    channel_config_set_transfer_data_size(&rrobin_clear_cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&rrobin_clear_cfg, false);
+    channel_config_set_write_increment(&rrobin_clear_cfg, false);
+    channel_config_set_chain_to(&rrobin_clear_cfg, adc_dma_pong);
+
     //settings semaphore
     sem_init(&settings_semaphore, 1, 1);
 
@@ -420,13 +495,11 @@ rx::rx(rx_settings & settings_to_apply, rx_status & status) : settings_to_apply(
     channel_config_set_write_increment(&capture_cfg, true);
 
     dma_set_irq0_channel_mask_enabled((1u<<adc_dma_ping) | (1u<<adc_dma_pong), true);
-    irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
-    irq_set_enabled(DMA_IRQ_0, true);
 
 
 }
 
-void rx::read_batt_temp()
+void __not_in_flash_func(rx::read_batt_temp)()
 {
   adc_select_input(3);
   battery = 0;
@@ -442,12 +515,119 @@ void rx::read_batt_temp()
   }
 }
 
+//Pick out the battery and temperature readings from the start of a pong
+//block, and replace them with I/Q interpolated from the neighbouring samples.
+//16 readings are summed, giving the same scale as read_batt_temp.
+void __not_in_flash_func(rx::housekeeping)(uint16_t samples[])
+{
+  battery_sum += samples[2];
+  temp_sum += samples[3];
+  if(++housekeeping_count == 16)
+  {
+    battery = battery_sum;
+    temp = temp_sum;
+    battery_sum = 0;
+    temp_sum = 0;
+    housekeeping_count = 0;
+  }
+  samples[2] = (samples[0] + samples[4]) >> 1;
+  samples[3] = (samples[1] + samples[5]) >> 1;
+}
+
+//A block must be processed before the next block completes, after that the
+//DMA starts to overwrite it. Blocks are counted as they complete (in the DMA
+//handler) and as they are processed, so a late block is always detected.
+bool __not_in_flash_func(rx::check_deadline)()
+{
+  const uint32_t captured = blocks_captured;
+  const bool missed = captured > ++blocks_processed;
+  if(missed)
+  {
+    deadline_misses++;
+    blocks_processed = captured;
+  }
+  return missed;
+}
+
+//Rolling DSP load (256 = 100%) from the time taken to process each block.
+//When PICORX_LOAD_SHEDDING is enabled, the most expensive optional features
+//are disabled one at a time on repeated missed deadlines or sustained high
+//load, and re-enabled once the load has stayed low for about a second.
+void __not_in_flash_func(rx::update_load)(uint32_t busy_us, bool missed)
+{
+  static const uint32_t block_time_us = 1000000ull * adc_block_size / adc_sample_rate;
+  const uint32_t load = std::min((busy_us << 8) / block_time_us, (uint32_t)1023);
+  load_average += ((int32_t)load - (int32_t)load_average) >> 3;
+
+#ifdef PICORX_LOAD_SHEDDING
+  static const uint16_t shed_high = 230; //90%
+  static const uint16_t shed_low = 154;  //60%
+  static const uint16_t settle_blocks = 16;
+  static const uint16_t restore_blocks = 256;
+  static const uint8_t shed_miss_limit = 3;
+  static const uint8_t miss_window_blocks = 64;
+
+  if(shed_settle) shed_settle--;
+
+  //an occasional miss (e.g. a flash write) is tolerated, only shed when
+  //several deadlines are missed within a window
+  if(missed && shed_misses < shed_miss_limit) shed_misses++;
+  if(++miss_window == miss_window_blocks)
+  {
+    miss_window = 0;
+    shed_misses = 0;
+  }
+
+  if((shed_misses == shed_miss_limit || load_average > shed_high) && shed_level < shed_num_features)
+  {
+    //give the previous change time to take effect
+    if(!shed_settle)
+    {
+      shed_level++;
+      shed_settle = settle_blocks;
+      shed_quiet = 0;
+      shed_misses = 0;
+      rx_dsp_inst.set_shed_features((1u << shed_level) - 1);
+    }
+  }
+  else if(load_average < shed_low && shed_level)
+  {
+    if(++shed_quiet == restore_blocks)
+    {
+      shed_level--;
+      shed_settle = settle_blocks;
+      shed_quiet = 0;
+      rx_dsp_inst.set_shed_features((1u << shed_level) - 1);
+    }
+  }
+  else
+  {
+    shed_quiet = 0;
+  }
+#endif
+}
+
+//TinyUSB runs from flash, so USB is paused while core 0 writes to flash
+static std::atomic<bool> usb_paused{false};
+static std::atomic<bool> usb_busy{false};
+
 static bool __not_in_flash_func(usb_callback)(repeating_timer_t *rt)
 {
-  usb_audio_device_task();
+  usb_busy = true;
+  if(!usb_paused) usb_audio_device_task();
+  usb_busy = false;
   return true; // keep repeating
 }
 
+void rx::pause_usb(bool pause)
+{
+  usb_paused = pause;
+  //the callback runs from the alarm pool interrupt on core 0, so it can't be
+  //part way through when core 0 is here, this only matters if the pool is
+  //ever created on core 1
+  while(pause && usb_busy) tight_loop_contents();
+}
+
 void rx::set_alarm_pool(alarm_pool_t *p)
 {
   pool = p;
@@ -475,10 +655,15 @@ static void on_usb_audio_tx_ready()
   usb_audio_device_write(usb_buf, sizeof(usb_buf));
 }
 
-//thread safe method to get raw IQ data
-bool rx::get_raw_data(int16_t &i, int16_t &q)
+//thread safe (lock-free) access to raw IQ data, call from core 0 only
+uint32_t rx::peek_raw_data(const s_iq_sample *&samples)
+{
+  return rx_dsp_inst.peek_raw_data(samples);
+}
+
+void rx::consume_raw_data(uint32_t num_samples)
 {
-  return rx_dsp_inst.get_raw_data(i, q);
+  rx_dsp_inst.consume_raw_data(num_samples);
 }
 
 uint32_t rx::get_iq_buffer_level()
@@ -486,6 +671,16 @@ uint32_t rx::get_iq_buffer_level()
   return rx_dsp_inst.get_iq_buffer_level();
 }
 
+uint32_t rx::get_iq_buffer_overflows()
+{
+  return rx_dsp_inst.get_iq_buffer_overflows();
+}
+
+uint32_t rx::get_iq_buffer_high_water_mark()
+{
+  return rx_dsp_inst.get_iq_buffer_high_water_mark();
+}
+
 void __not_in_flash_func(rx::process_block)(uint16_t adc_samples[], int16_t audio[])
 {
   //capture usb volume and mute settings
@@ -538,14 +733,38 @@ void rx::run()
     bool ret = alarm_pool_add_repeating_timer_us(pool, 1067 / 2, usb_callback, NULL, &usb_timer);
     hard_assert(ret);
 
+    //the DMA interrupt must belong to core 1, it re-arms the ping/pong
+    //transfers, and core 0 disables its interrupts while flash is written
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    stream();
+}
+
+//same as dma_channel_cleanup, but runs from RAM
+static void __not_in_flash_func(stop_dma_channel)(uint channel)
+{
+  hw_write_masked(&dma_hw->ch[channel].al1_ctrl, (channel << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB), DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS | DMA_CH0_CTRL_TRIG_EN_BITS);
+  dma_channel_set_irq0_enabled(channel, false);
+  dma_channel_abort(channel);
+  dma_hw->intr = 1u << channel;
+}
+
+//Everything core 1 runs from here on is placed in RAM, so that streaming can
+//continue while core 0 writes to flash (see PICORX_RAM_DSP).
+void __not_in_flash_func(rx::stream)()
+{
+    rx_settings snapshot;
+
     while(true)
     {
-      if(settings_changed) apply_settings();
 
-
-      //read other adc channels when streaming is not running
-      uint32_t timeout = 15000;
+      //read other adc channels before streaming starts, after that they
+      //are part of the stream
       read_batt_temp();
+      battery_sum = 0;
+      temp_sum = 0;
+      housekeeping_count = 0;
 
       //supress audio output until first block has completed
       audio_running = false;
@@ -556,9 +775,14 @@ void rx::run()
       adc_select_input(0);
       adc_set_round_robin(3);
       dma_channel_configure(adc_dma_ping, &ping_cfg, ping_samples, &adc_hw->fifo, adc_block_size, false);
-      dma_channel_configure(adc_dma_pong, &pong_cfg, pong_samples, &adc_hw->fifo, adc_block_size, false);
+      dma_channel_configure(adc_dma_rrobin_set, &rrobin_set_cfg, hw_set_alias(&adc_hw->cs), &housekeeping_rrobin, 1, false);
+      dma_channel_configure(adc_dma_housekeeping, &housekeeping_cfg, pong_samples, &adc_hw->fifo, housekeeping_samples, false);
+      dma_channel_configure(adc_dma_rrobin_clear, &rrobin_clear_cfg, hw_clear_alias(&adc_hw->cs), &housekeeping_rrobin, 1, false);
+      dma_channel_configure(adc_dma_pong, &pong_cfg, pong_samples + housekeeping_samples, &adc_hw->fifo, adc_block_size - housekeeping_samples, false);
       dma_channel_set_irq0_enabled(adc_dma_ping, true);
       dma_channel_set_irq0_enabled(adc_dma_pong, true);
+      blocks_captured = 0;
+      blocks_processed = 0;
       dma_start_channel_mask(1u << adc_dma_ping);
       adc_run(true);
 
@@ -569,12 +793,25 @@ void rx::run()
           //exchange data with UI (runing in core 0)
           update_status();
 
-          //periodically (or when requested) suspend streaming
-          if(timeout-- == 0 || suspend || settings_changed)
+          //pick up new settings at the block boundary, most can be applied
+          //without interrupting the stream
+          bool restart = false;
+          bool first;
+          if(settings_snapshot_inst.read(snapshot, first))
+          {
+            restart = apply_settings(snapshot, first);
+            settings_snapshot_inst.applied(snapshot, first, restart);
+          }
+
+          //suspend streaming when requested
+          if(suspend || restart)
           {
 
-            dma_channel_cleanup(adc_dma_ping);
-            dma_channel_cleanup(adc_dma_pong);
+            stop_dma_channel(adc_dma_ping);
+            stop_dma_channel(adc_dma_rrobin_set);
+            stop_dma_channel(adc_dma_housekeeping);
+            stop_dma_channel(adc_dma_rrobin_clear);
+            stop_dma_channel(adc_dma_pong);
             pwm_audio_sink_stop();
 
             adc_run(false);
@@ -589,11 +826,16 @@ void rx::run()
           dma_channel_wait_for_finish_blocking(adc_dma_ping);
           uint32_t start_time = time_us_32();
           process_block(ping_samples, audio);
+          bool missed = check_deadline();
           busy_time = pwm_audio_sink_push(audio, gain_numerator);
           busy_time -= start_time;
+          update_load(busy_time, missed);
           dma_channel_wait_for_finish_blocking(adc_dma_pong);
+          start_time = time_us_32();
+          housekeeping(pong_samples);
           process_block(pong_samples, audio);
-          pwm_audio_sink_push(audio, gain_numerator);
+          missed = check_deadline();
+          update_load(pwm_audio_sink_push(audio, gain_numerator) - start_time, missed);
       }
 
       //suspended state
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <math.h>
 #include <ctime>
+#include <atomic>
 #include "nco.pio.h"
 
 #include "pico/stdlib.h"
@@ -16,50 +17,12 @@
 
 #include "rx_definitions.h"
 #include "rx_dsp.h"
-
-struct rx_settings
-{
-  double tuned_frequency_Hz;
-  int step_Hz;
-  uint8_t agc_setting;
-  uint8_t agc_gain;
-  uint8_t mode;
-  uint8_t volume;
-  uint8_t squelch_threshold;
-  uint8_t squelch_timeout;
-  uint8_t bandwidth;
-  uint8_t deemphasis;
-  uint8_t treble;
-  uint8_t bass;
-  uint16_t cw_sidetone_Hz;
-  uint16_t gain_cal;
-  uint8_t band_1_limit;
-  uint8_t band_2_limit;
-  uint8_t band_3_limit;
-  uint8_t band_4_limit;
-  uint8_t band_5_limit;
-  uint8_t band_6_limit;
-  uint8_t band_7_limit;
-  uint8_t impulse_threshold;
-  int8_t ppm;
-  bool suspend;
-  bool swap_iq;
-  bool iq_correction;
-  bool enable_auto_notch;
-  bool enable_noise_reduction;
-  uint8_t noise_estimation;
-  uint8_t noise_threshold;
-  uint8_t if_frequency_hz_over_100;
-  uint8_t if_mode;
-  uint8_t spectrum_smoothing;
-  uint8_t tuning_option;
-  bool enable_external_nco;
-  bool stream_raw_iq;
-};
+#include "rx_settings.h"
 
 struct rx_status
 {
   int32_t signal_strength_dBm;
+  int16_t snr_dB;
   uint32_t busy_time;
   uint16_t temp;
   uint16_t battery;
@@ -68,6 +31,10 @@ struct rx_status
   uint16_t audio_level;
   float tuning_offset_Hz;
   bool transmitting;
+  uint32_t restarts_avoided;
+  uint32_t deadline_misses;
+  uint8_t dsp_load;
+  uint8_t shed_features;
 };
 
 class rx
@@ -75,6 +42,8 @@ class rx
   private:
 
   void update_status();
+  bool apply_settings(const rx_settings &settings, bool apply_all);
+  void set_band(const rx_settings &settings);
   void tx_update_status();
   void set_usb_callbacks();
 
@@ -83,11 +52,21 @@ class rx
   double tuned_frequency_Hz;
   double nco_frequency_Hz;
   double offset_frequency_Hz;
+  uint8_t nco_pll_index = 0xff;
+  bool nco_retune = true;
+  int16_t passband_low_Hz = 0;
+  int16_t passband_high_Hz = 0;
   semaphore_t settings_semaphore;
   bool settings_changed;
+
+  //settings published by core 0 for core 1
+  settings_snapshot settings_snapshot_inst;
   bool suspend;
   uint16_t temp;
   uint16_t battery;
+  uint32_t temp_sum;
+  uint32_t battery_sum;
+  uint8_t housekeeping_count;
   uint8_t if_frequency_hz_over_100;
   uint8_t if_mode;
   int8_t ppm=0;
@@ -105,18 +84,39 @@ class rx
   //buffers and dma for adc
   static int adc_dma_ping;
   static int adc_dma_pong;
+  static int adc_dma_rrobin_set;
+  static int adc_dma_housekeeping;
+  static int adc_dma_rrobin_clear;
   static dma_channel_config ping_cfg;
   static dma_channel_config pong_cfg;
+  static dma_channel_config rrobin_set_cfg;
+  static dma_channel_config housekeeping_cfg;
+  static dma_channel_config rrobin_clear_cfg;
   static uint16_t ping_samples[adc_block_size];
   static uint16_t pong_samples[adc_block_size];
 
   static bool audio_running;
   static void dma_handler();
   void process_block(uint16_t adc_samples[], int16_t audio[]);
+  void stream();
+  void housekeeping(uint16_t samples[]);
+  bool check_deadline();
+  void update_load(uint32_t busy_us, bool missed);
   
   //store busy time for performance monitoring
   uint32_t busy_time;
 
+  //deadline and load monitoring
+  static volatile uint32_t blocks_captured;
+  uint32_t blocks_processed = 0;
+  uint32_t deadline_misses = 0;
+  uint16_t load_average = 0;
+  uint8_t shed_level = 0;
+  uint16_t shed_settle = 0;
+  uint16_t shed_quiet = 0;
+  uint8_t shed_misses = 0;
+  uint8_t miss_window = 0;
+
   alarm_pool_t *pool = NULL;
 
   //volume control
@@ -134,7 +134,6 @@ class rx
 
   public:
   rx(rx_settings & settings_to_apply, rx_status & status);
-  void apply_settings();
   void run();
   void tune();
   void get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom);
@@ -146,8 +145,12 @@ class rx
   void read_batt_temp();
   void access(bool settings_changed);
   void release();
-  bool get_raw_data(int16_t &i, int16_t &q);
+  void pause_usb(bool pause);
+  uint32_t peek_raw_data(const s_iq_sample *&samples);
+  void consume_raw_data(uint32_t num_samples);
   uint32_t get_iq_buffer_level();
+  uint32_t get_iq_buffer_overflows();
+  uint32_t get_iq_buffer_high_water_mark();
 };
 
 #endif
@@ -6,9 +6,22 @@
 const uint16_t decimation_rate = 32u; //cic decimation
 const uint16_t cic_decimation_rate = decimation_rate/2u;
 
-const uint16_t fft_size = 256;
+//FFT filter of 2^fft_order points (7 to 10), the ADC block size follows it
+#ifndef PICORX_FFT_ORDER
+#define PICORX_FFT_ORDER 8
+#endif
+const uint8_t  fft_order = PICORX_FFT_ORDER;
+const uint16_t fft_size = 1u << fft_order;
 const uint16_t new_fft_size = fft_size / 2;
 
+//the FFT tables are sized for the largest FFT in the build, the host
+//benchmarks compare all of the filter sizes
+#ifdef SIMULATION
+const uint8_t  fft_max_order = 10;
+#else
+const uint8_t  fft_max_order = fft_order;
+#endif
+
 const uint32_t adc_sample_rate = 480e3;
 const uint32_t audio_sample_rate = adc_sample_rate / decimation_rate;
 const uint32_t pwm_audio_sample_rate = adc_sample_rate / 2;
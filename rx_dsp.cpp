@@ -4,12 +4,12 @@
 #include "utils.h"
 #include "pico/stdlib.h"
 #include "cic_corrections.h"
+#include "tone_controls.h"
 
 #include <math.h>
 #include <cstdio>
 #include <algorithm>
 
-static const int16_t deemph_taps[2][3] = {{14430, 14430, -3909}, {10571, 10571, -11626}};
 int16_t __not_in_flash_func(rx_dsp :: apply_deemphasis)(int16_t x)
 {
 if (deemphasis == 0) return x;
@@ -39,12 +39,6 @@ if (deemphasis == 0) return x;
 }
 
 int16_t __not_in_flash_func(rx_dsp ::apply_treble)(int16_t x) {
-  static const int32_t treble_taps[4][2][3] = {
-      {{26363, -36747, 14207}, {16383, -19828, 7267}},
-      {{42359, -62303, 24741}, {16383, -18062, 6476}},
-      {{67860, -104422, 42534}, {16383, -16114, 5703}},
-      {{108241, -173031, 72157}, {16383, -13987, 4972}}};
-
   static int16_t x1 = 0;
   static int16_t y1 = 0;
   static int16_t x2 = 0;
@@ -80,12 +74,6 @@ int16_t __not_in_flash_func(rx_dsp ::apply_treble)(int16_t x) {
 }
 
 int16_t __not_in_flash_func(rx_dsp ::apply_bass)(int16_t x) {
-  static const int32_t bass_taps[4][2][3] = {
-      {{16808, -30178, 13691}, {16383, -30248, 14045}},
-      {{17253, -30437, 13616}, {16383, -30584, 14338}},
-      {{17728, -30637, 13490}, {16383, -30876, 14596}},
-      {{18245, -30777, 13313}, {16383, -31129, 14824}}};
-
   static int16_t x1 = 0;
   static int16_t y1 = 0;
   static int16_t x2 = 0;
@@ -123,7 +111,7 @@ void __not_in_flash_func(rx_dsp ::apply_impulse_blanker)(int16_t &i, int16_t &q,
                                                          uint16_t mag) {
   static uint32_t avg_g = 32767;
   static uint32_t avg_mag;
-  const uint32_t thres_lut[6] = {98301, 91748, 85194, 78641,
+  static const uint32_t __not_in_flash("thres_lut") thres_lut[6] = {98301, 91748, 85194, 78641,
                                  72087, 65534};  // 3.0 to 2.0 in 0.2 steps
 
   if(impulse_threshold == 0)
@@ -165,7 +153,7 @@ static uint32_t __not_in_flash_func(intsqrt)(const uint32_t n) {
     return result;
 }
 
-void inline rx_dsp :: iq_imbalance_correction(int16_t &i, int16_t &q)
+void inline __not_in_flash_func(rx_dsp :: iq_imbalance_correction)(int16_t &i, int16_t &q)
 {
     if (iq_correction)
     {
@@ -210,122 +198,171 @@ void inline rx_dsp :: iq_imbalance_correction(int16_t &i, int16_t &q)
     }
 }
 
+//every 4th audio sample of each block is kept for the waveform display
+static const uint16_t audio_capture_block = adc_block_size / decimation_rate / 4;
+
 uint16_t __not_in_flash_func(rx_dsp :: process_block)(uint16_t samples[], int16_t audio_samples[], ring_buffer_t *iq_samples)
 {
 
-  uint16_t decimated_index = 0;
   int32_t magnitude_sum = 0;
   int16_t iq[2 * adc_block_size / cic_decimation_rate];
 
-  for(uint16_t idx=0; idx<adc_block_size; idx++)
+  if(filter_mask_stale)
   {
-      //convert to signed representation
-      const int16_t raw_sample = samples[idx];
+    update_filter_mask();
+    filter_mask_stale = false;
+  }
 
-      //work out which samples are i and q
-      int16_t i = ((idx&1)^1^swap_iq)*raw_sample;//even samples contain i data
-      int16_t q = ((idx&1)^swap_iq)*raw_sample;//odd samples contain q data
+  DSP_PROFILE_START();
 
-      //reduce sample rate by a factor of 16
-      if(decimate(i, q))
-      {
+  //reduce sample rate by a factor of 16
+  //even samples contain i data, odd samples contain q data (unless swapped)
+  cic_i.process_block(samples, swap_iq, &iq[0]);
+  cic_q.process_block(samples, !swap_iq, &iq[1]);
 
-        static uint32_t iq_count = 0;
-        static int32_t i_accumulator = 0;
-        static int32_t q_accumulator = 0;
-        static int16_t i_avg = 0;
-        static int16_t q_avg = 0;
-        i_accumulator += i;
-        q_accumulator += q;
-        if (++iq_count == 2048) //power of 2 avoids division
-        {
-          i_avg = i_accumulator / 2048;
-          q_avg = q_accumulator / 2048;
-          i_accumulator = 0;
-          q_accumulator = 0;
-          iq_count = 0;
-        }
-        i -= i_avg;
-        q -= q_avg;
-
-        iq_imbalance_correction(i, q);
-
-        //Apply frequency shift (move tuned frequency to DC)
-        frequency_shift(i, q);
-
-        #ifdef MEASURE_DC_BIAS 
-        static int64_t bias_measurement = 0; 
-        static int32_t num_bias_measurements = 0; 
-        if(num_bias_measurements == 100000) { 
-          printf("DC BIAS x 100 %lli\n", bias_measurement/1000); 
-          num_bias_measurements = 0; 
-          bias_measurement = 0; 
-        } 
-        else { 
-          num_bias_measurements++; 
-          bias_measurement += i; 
-        } 
-        #endif 
-
-        iq[decimated_index] = i;
-        iq[decimated_index + 1] = q;
-        decimated_index+=2;
-      }
+  DSP_PROFILE_END_STAGE(dsp_stage_cic);
+
+  //each stage has its own state, so running them as separate passes over the
+  //block gives the same result as one pass, and each can be timed
+  for(uint16_t idx=0; idx<adc_block_size/cic_decimation_rate; idx++)
+  {
+    int16_t i = iq[2 * idx];
+    int16_t q = iq[2 * idx + 1];
+
+    static uint32_t iq_count = 0;
+    static int32_t i_accumulator = 0;
+    static int32_t q_accumulator = 0;
+    static int16_t i_avg = 0;
+    static int16_t q_avg = 0;
+    i_accumulator += i;
+    q_accumulator += q;
+    if (++iq_count == 2048) //power of 2 avoids division
+    {
+      i_avg = i_accumulator / 2048;
+      q_avg = q_accumulator / 2048;
+      i_accumulator = 0;
+      q_accumulator = 0;
+      iq_count = 0;
+    }
+    iq[2 * idx] = i - i_avg;
+    iq[2 * idx + 1] = q - q_avg;
   }
 
+  DSP_PROFILE_END_STAGE(dsp_stage_dc_removal);
+
+  if(!(shed_features & shed_iq_correction))
+  {
+    for(uint16_t idx=0; idx<adc_block_size/cic_decimation_rate; idx++)
+    {
+      iq_imbalance_correction(iq[2 * idx], iq[2 * idx + 1]);
+    }
+  }
+
+  DSP_PROFILE_END_STAGE(dsp_stage_iq_correction);
+
+  for(uint16_t idx=0; idx<adc_block_size/cic_decimation_rate; idx++)
+  {
+    //Apply frequency shift (move tuned frequency to DC)
+    frequency_shift(iq[2 * idx], iq[2 * idx + 1]);
+
+    #ifdef MEASURE_DC_BIAS 
+    static int64_t bias_measurement = 0; 
+    static int32_t num_bias_measurements = 0; 
+    if(num_bias_measurements == 100000) { 
+      printf("DC BIAS x 100 %lli\n", bias_measurement/1000); 
+      num_bias_measurements = 0; 
+      bias_measurement = 0; 
+    } 
+    else { 
+      num_bias_measurements++; 
+      bias_measurement += iq[2 * idx]; 
+    } 
+    #endif 
+  }
+
+  DSP_PROFILE_END_STAGE(dsp_stage_frequency_shift);
+
   //fft filter decimates a further 2x
   //if the capture buffer isn't in use, fill it
-  filter_control.capture = sem_try_acquire(&spectrum_semaphore);
-  capture_filter_control = filter_control;
-  fft_filter_inst.process_sample(iq, filter_control, capture);
-  if(filter_control.capture) sem_release(&spectrum_semaphore);
+  s_filter_control control = filter_control;
+  control.capture = !(shed_features & shed_spectrum) && sem_try_acquire(&spectrum_semaphore);
+  if(shed_features & shed_noise_reduction) control.enable_noise_reduction = false;
+  if(shed_features & shed_auto_notch) control.enable_auto_notch = false;
+
+  //the tone controls are in the filter mask where the mode allows, see
+  //update_filter_mask
+  const bool tone_controls_in_fft = fft_tone_controls && (mode == LSB || mode == USB || mode == CW);
+  capture_filter_control = control;
+
+  fft_filter_inst.process_sample(iq, control, capture);
+  if(control.capture) sem_release(&spectrum_semaphore);
+  if(narrow_cw())
+  {
+    narrow_filter_inst.process_block(iq, adc_block_size/decimation_rate);
+  }
+
+  DSP_PROFILE_END_STAGE(dsp_stage_fft_filter);
 
-  for(uint16_t idx=0; idx<adc_block_size/decimation_rate; idx++)
+  //Demodulate to give audio samples, and measure amplitude (for signal
+  //strength indicator)
+  const uint16_t num_audio_samples = adc_block_size/decimation_rate;
+  switch(mode)
   {
-    int16_t i = iq[2 * idx];
-    int16_t q = iq[2 * idx + 1];
+    case AM:     magnitude_sum = demodulate_block<AM>(iq, audio_samples, num_audio_samples); break;
+    case AMSYNC: magnitude_sum = demodulate_block<AMSYNC>(iq, audio_samples, num_audio_samples); break;
+    case LSB:    magnitude_sum = demodulate_block<LSB>(iq, audio_samples, num_audio_samples); break;
+    case USB:    magnitude_sum = demodulate_block<USB>(iq, audio_samples, num_audio_samples); break;
+    case FM:
+      if(fm_discriminator == fm_discriminator_product) magnitude_sum = demodulate_fm(iq, audio_samples, num_audio_samples);
+      else magnitude_sum = demodulate_block<FM>(iq, audio_samples, num_audio_samples);
+      break;
+    default:     magnitude_sum = demodulate_block<CW>(iq, audio_samples, num_audio_samples); break;
+  }
 
-    uint32_t complex_sample = (uint32_t)i << 16 | ((uint32_t)q & 0xffff);
-    queue_try_add(&data_queue, (void*)&complex_sample);
+  DSP_PROFILE_END_STAGE(dsp_stage_demodulate);
+
+  if(!tone_controls_in_fft)
+  {
+    //the product FM discriminator applies its own de-emphasis
+    const bool deemphasis_in_demod = mode == FM && fm_discriminator == fm_discriminator_product;
+    for(uint16_t idx=0; idx<adc_block_size/decimation_rate; idx++)
+    {
+      //De-emphasis
+      int16_t audio = deemphasis_in_demod ? audio_samples[idx] : apply_deemphasis(audio_samples[idx]);
 
-    //Measure amplitude (for signal strength indicator)
-    uint16_t magnitude;
-    int16_t phase;
-    rectangular_2_polar(i, q, &magnitude, &phase);
-    magnitude_sum += magnitude;
+      // Bass
+      audio = apply_bass(audio);
 
-    // Impulse noise blanker
-    apply_impulse_blanker(i, q, magnitude);
+      // Treble
+      audio_samples[idx] = apply_treble(audio);
+    }
+  }
 
-    //Demodulate to give audio sample
-    int32_t audio = demodulate(i, q, magnitude, phase);
+  DSP_PROFILE_END_STAGE(dsp_stage_post_filters);
 
-    //De-emphasis
-    audio = apply_deemphasis(audio);
+  //Automatic gain control scales signal to use full 16 bit range
+  //e.g. -32767 to 32767
+  automatic_gain_control(audio_samples, num_audio_samples);
 
-    // Bass
-    audio = apply_bass(audio);
+  DSP_PROFILE_END_STAGE(dsp_stage_agc);
 
-    // Treble
-    audio = apply_treble(audio);
+  //average over the number of samples
+  signal_amplitude = (magnitude_sum * decimation_rate)/adc_block_size;
 
-    //Automatic gain control scales signal to use full 16 bit range
-    //e.g. -32767 to 32767
-    audio = automatic_gain_control(audio);
+  //squelch
+  squelch(audio_samples, num_audio_samples);
 
-    //squelch
-    audio = squelch(audio, signal_amplitude);
+  DSP_PROFILE_END_STAGE(dsp_stage_squelch);
 
-    //output raw audio
-    audio_samples[idx] = audio;
-  }
+  //capture samples for decoding
+  iq_ring.push_block(reinterpret_cast<const s_iq_sample*>(iq), adc_block_size/decimation_rate);
 
   if (sem_try_acquire(&audio_semaphore)) {
     for (uint16_t idx = 0; idx < adc_block_size / decimation_rate; idx+=4) {
-      audio_capture[audio_capture_idx * 16 + (idx / 4)] = audio_samples[idx];
+      audio_capture[audio_capture_idx * audio_capture_block + (idx / 4)] = audio_samples[idx];
     }
     audio_capture_idx++;
-    if (audio_capture_idx == 8) {
+    if (audio_capture_idx == 128 / audio_capture_block) {
       audio_capture_idx = 0;
     }
     sem_release(&audio_semaphore);
@@ -337,8 +374,8 @@ uint16_t __not_in_flash_func(rx_dsp :: process_block)(uint16_t samples[], int16_
         2 * sizeof(int16_t) * adc_block_size / decimation_rate);
   }
 
-  //average over the number of samples
-  signal_amplitude = (magnitude_sum * decimation_rate)/adc_block_size;
+  DSP_PROFILE_END_STAGE(dsp_stage_output);
+  DSP_PROFILE_END_BLOCK();
 
   return adc_block_size/decimation_rate;
 }
@@ -360,53 +397,6 @@ void __not_in_flash_func(rx_dsp :: frequency_shift)(int16_t &i, int16_t &q)
     q = q_shifted;
 }
 
-bool __not_in_flash_func(rx_dsp :: decimate)(int16_t &i, int16_t &q)
-{
-
-      //CIC decimation filter
-      //implement integrator stages
-      integratori1 += i;
-      integratorq1 += q;
-      integratori2 += integratori1;
-      integratorq2 += integratorq1;
-      integratori3 += integratori2;
-      integratorq3 += integratorq2;
-      integratori4 += integratori3;
-      integratorq4 += integratorq3;
-
-      decimate_count++;
-      if(decimate_count >= cic_decimation_rate)
-      {
-        decimate_count = 0;
-
-        //implement comb stages
-        const int32_t combi1 = integratori4-delayi0;
-        const int32_t combq1 = integratorq4-delayq0;
-        const int32_t combi2 = combi1-delayi1;
-        const int32_t combq2 = combq1-delayq1;
-        const int32_t combi3 = combi2-delayi2;
-        const int32_t combq3 = combq2-delayq2;
-        const int32_t combi4 = combi3-delayi3;
-        const int32_t combq4 = combq3-delayq3;
-        delayi0 = integratori4;
-        delayq0 = integratorq4;
-        delayi1 = combi1;
-        delayq1 = combq1;
-        delayi2 = combi2;
-        delayq2 = combq2;
-        delayi3 = combi3;
-        delayq3 = combq3;
-
-        //remove bit growth, but keep some extra bits since noise floor is now lower
-        i = combi4>>(cic_bit_growth-extra_bits);
-        q = combq4>>(cic_bit_growth-extra_bits);
-
-        return true;
-      }
-
-      return false;
-}
-
 // For the formulas see 'PicoRX/simulations/am_sync_des.py:pll_3rd_order_des'
 // PLL loop bandwidth: 30Hz
 #define AMSYNC_NUM_TAPS (3)
@@ -437,97 +427,302 @@ inline int32_t wrap(int32_t x) {
 
 void rx_dsp::amsync_reset(void) { amsync = {0}; }
 
-int16_t __not_in_flash_func(rx_dsp :: demodulate)(int16_t i, int16_t q, uint16_t magnitude, int16_t phase)
+int16_t __not_in_flash_func(rx_dsp :: demodulate_amsync)(int16_t i, int16_t q)
 {
-    int16_t frequency = phase - last_phase;
-    last_phase = phase;
-
-    frequency_accumulator += frequency;
-    frequency_count ++;
+    size_t idx = (amsync.phase_locked / AMSYNC_PHI_SCALE);
 
-    if(mode == AM)
-    {
-        const int16_t amplitude = magnitude;
-        //measure DC using first order IIR low-pass filter
-        audio_dc = amplitude+(audio_dc - (audio_dc >> 5));
-        //subtract DC component
-        return amplitude - (audio_dc >> 5);
+    if (amsync.phase_locked < 0) {
+      idx = 2048 + idx;
     }
-    else if(mode == AMSYNC)
-    {
-      size_t idx = (amsync.phase_locked / AMSYNC_PHI_SCALE);
 
-      if (amsync.phase_locked < 0) {
-        idx = 2048 + idx;
-      }
+    // VCO
+    const int32_t vco_i = sin_table[(idx + 512u) & 0x7ffu];
+    const int32_t vco_q = sin_table[idx & 0x7ffu];
 
-      // VCO
-      const int32_t vco_i = sin_table[(idx + 512u) & 0x7ffu];
-      const int32_t vco_q = sin_table[idx & 0x7ffu];
+    // Phase Detector
+    const int16_t synced_i = (i * vco_i + q * vco_q) >> AMSYNC_BASE_FRACTION_BITS;
+    const int16_t synced_q = (-i * vco_q + q * vco_i) >> AMSYNC_BASE_FRACTION_BITS;
 
-      // Phase Detector
-      const int16_t synced_i = (i * vco_i + q * vco_q) >> AMSYNC_BASE_FRACTION_BITS;
-      const int16_t synced_q = (-i * vco_q + q * vco_i) >> AMSYNC_BASE_FRACTION_BITS;
+    int16_t phi;
+    uint16_t mag;
 
-      int16_t phi;
-      uint16_t mag;
+    polar_cordic::rectangular_2_polar(synced_i, synced_q, mag, phi);
 
-      rectangular_2_polar(synced_i, synced_q, &mag, &phi);
+    const int32_t phi_err = ((int32_t)phi * AMSYNC_ERR_SCALE);
 
-      const int32_t phi_err = ((int32_t)phi * AMSYNC_ERR_SCALE);
+    int32_t y0 = phi_err * AMSYNC_B0 + amsync.x1 * AMSYNC_B1 + amsync.x2 * AMSYNC_B2;
+    y0 += amsync.y0_err;
+    amsync.y0_err = y0 & AMSYNC_FILT_ONE;
+    y0 >>= AMSYNC_FILT_BITS;
+    y0 += 2 * amsync.y1 - amsync.y2;
+    amsync.y2 = amsync.y1;
+    amsync.y1 = y0;
+    amsync.x2 = amsync.x1;
+    amsync.x1 = phi_err;
+    amsync.phase_locked += y0;
 
-      int32_t y0 = phi_err * AMSYNC_B0 + amsync.x1 * AMSYNC_B1 + amsync.x2 * AMSYNC_B2;
-      y0 += amsync.y0_err;
-      amsync.y0_err = y0 & AMSYNC_FILT_ONE;
-      y0 >>= AMSYNC_FILT_BITS;
-      y0 += 2 * amsync.y1 - amsync.y2;
-      amsync.y2 = amsync.y1;
-      amsync.y1 = y0;
-      amsync.x2 = amsync.x1;
-      amsync.x1 = phi_err;
-      amsync.phase_locked += y0;
+    amsync.phase_locked = wrap(amsync.phase_locked);
 
-      amsync.phase_locked = wrap(amsync.phase_locked);
+    // measure DC using first order IIR low-pass filter
+    audio_dc = synced_i + (audio_dc - (audio_dc >> 5));
+    // subtract DC component
+    return synced_i - (audio_dc >> 5);
+}
 
-      // measure DC using first order IIR low-pass filter
-      audio_dc = synced_i + (audio_dc - (audio_dc >> 5));
-      // subtract DC component
-      return synced_i - (audio_dc >> 5);
-    }
-    else if(mode == FM)
+//modes that don't need the phase of each sample measure the tuning offset
+//once per block, from the average phase change between samples
+void __not_in_flash_func(rx_dsp :: measure_tuning_offset)(const int16_t iq[], uint16_t num_samples)
+{
+    int64_t real = 0;
+    int64_t imag = 0;
+    for(uint16_t idx=1; idx<num_samples; idx++)
     {
-        return frequency;
+      const int32_t i = iq[2 * idx], q = iq[2 * idx + 1];
+      const int32_t last_i = iq[2 * idx - 2], last_q = iq[2 * idx - 1];
+      real += i * last_i + q * last_q;
+      imag += q * last_i - i * last_q;
     }
-    else if(mode == LSB || mode == USB)
+    if(!real && !imag) return;
+
+    //scale the sums to fit the cordic, only the angle is needed
+    const uint64_t largest = std::max(real < 0 ? -real : real, imag < 0 ? -imag : imag);
+    uint8_t shift = 0;
+    while((largest >> shift) > INT16_MAX) shift++;
+
+    //in the units of the phase from the cordic, weighted as if each
+    //sample had been measured
+    uint16_t unused_magnitude;
+    int16_t frequency;
+    offset_cordic::rectangular_2_polar(real >> shift, imag >> shift, unused_magnitude, frequency);
+    frequency_accumulator += (int32_t)frequency * num_samples;
+    frequency_count += num_samples;
+}
+
+//one demodulator for each mode, each computes only what its mode needs
+#ifndef SIMULATION
+template<uint8_t demod_mode>
+int32_t __not_in_flash_func(rx_dsp :: demodulate_block)(int16_t iq[], int16_t audio[], uint16_t num_samples)
+#else
+template<uint8_t demod_mode>
+int32_t rx_dsp :: demodulate_block(int16_t iq[], int16_t audio[], uint16_t num_samples)
+#endif
+{
+    const bool uses_phase = demod_mode == AM || demod_mode == FM;
+    if(!uses_phase) measure_tuning_offset(iq, num_samples);
+
+    //AM and FM demodulate the magnitude and phase before the blanker, the
+    //other modes only need the magnitude
+    uint16_t magnitudes[adc_block_size/decimation_rate];
+    int16_t phases[adc_block_size/decimation_rate];
+    if(uses_phase) polar_cordic::block(iq, magnitudes, phases, num_samples);
+    else magnitude_cordic::block(iq, magnitudes, NULL, num_samples);
+
+    int32_t magnitude_sum = 0;
+    for(uint16_t idx=0; idx<num_samples; idx++)
     {
-        return i;
+      int16_t i = iq[2 * idx];
+      int16_t q = iq[2 * idx + 1];
+
+      if(uses_phase)
+      {
+        const uint16_t magnitude = magnitudes[idx];
+        const int16_t phase = phases[idx];
+        magnitude_sum += magnitude;
+
+        const int16_t frequency = phase - last_phase;
+        last_phase = phase;
+        frequency_accumulator += frequency;
+        frequency_count ++;
+
+        // Impulse noise blanker
+        apply_impulse_blanker(i, q, magnitude);
+
+        if(demod_mode == AM)
+        {
+          const int16_t amplitude = magnitude;
+          //measure DC using first order IIR low-pass filter
+          audio_dc = amplitude+(audio_dc - (audio_dc >> 5));
+          //subtract DC component
+          audio[idx] = amplitude - (audio_dc >> 5);
+        }
+        else
+        {
+          audio[idx] = frequency;
+        }
+      }
+      else
+      {
+        const uint16_t magnitude = magnitudes[idx];
+        magnitude_sum += magnitude;
+
+        // Impulse noise blanker
+        apply_impulse_blanker(i, q, magnitude);
+
+        if(demod_mode == AMSYNC)
+        {
+          audio[idx] = demodulate_amsync(i, q);
+        }
+        else if(demod_mode == LSB || demod_mode == USB)
+        {
+          audio[idx] = i;
+        }
+        else //if(mode==cw)
+        {
+          cw_sidetone_phase += cw_sidetone_frequency_Hz * 2048 * decimation_rate / adc_sample_rate;
+          const int16_t rotation_i =  sin_table[(cw_sidetone_phase + 512u) & 0x7ffu];
+          const int16_t rotation_q = -sin_table[cw_sidetone_phase & 0x7ffu];
+          audio[idx] = ((i * rotation_i) - (q * rotation_q)) >> 15;
+        }
+      }
     }
-    else //if(mode==cw)
+    return magnitude_sum;
+}
+
+//FM discriminator without an arctangent, the phase change between samples is
+//approximately (i.dq - q.di)/(i^2 + q^2) radians, for small changes
+int32_t __not_in_flash_func(rx_dsp :: demodulate_fm)(int16_t iq[], int16_t audio[], uint16_t num_samples)
+{
+    //one pole de-emphasis, 32768 * (1 - exp(-1/(tau * fs))) for 50us and 75us
+    static_assert(audio_sample_rate == 15000, "recalculate deemphasis_alpha for the audio sample rate");
+    static const int32_t __not_in_flash("fm_deemphasis") deemphasis_alpha[] = {24130, 19297};
+    const int32_t alpha = deemphasis ? deemphasis_alpha[deemphasis - 1] : 0;
+
+    int32_t magnitude_sum = 0;
+    for(uint16_t idx=0; idx<num_samples; idx++)
     {
-      cw_sidetone_phase += cw_sidetone_frequency_Hz * 2048 * decimation_rate / adc_sample_rate;
-      const int16_t rotation_i =  sin_table[(cw_sidetone_phase + 512u) & 0x7ffu];
-      const int16_t rotation_q = -sin_table[cw_sidetone_phase & 0x7ffu];
-      return ((i * rotation_i) - (q * rotation_q)) >> 15;
+      const int32_t i = iq[2 * idx];
+      const int32_t q = iq[2 * idx + 1];
+      magnitude_sum += rectangular_2_magnitude(i, q);
+
+      //i.dq - q.di = q.last_i - i.last_q, halved so that it can't overflow
+      const int32_t cross = ((q * fm_last_i) >> 1) - ((i * fm_last_q) >> 1);
+      const uint32_t power = (uint32_t)(i * i) + (uint32_t)(q * q);
+      fm_last_i = i;
+      fm_last_q = q;
+
+      int16_t frequency = 0;
+      if(power)
+      {
+        //cross/power as cross' * reciprocal/2^30, where cross' is the cross
+        //product scaled to the size of the power, limited to a ratio of 2
+        uint8_t shift;
+        const uint32_t r = reciprocal(power, shift);
+        const int8_t scale = shift - 31; //cross was halved
+        int32_t scaled_cross = scale >= 0 ? cross >> scale : cross << -scale;
+        scaled_cross = std::max(std::min(scaled_cross, (int32_t)65535), (int32_t)-65535);
+        int32_t ratio = (scaled_cross * (int32_t)(r >> 1)) >> 14; //Q15
+        ratio = std::max(std::min(ratio, (int32_t)32767), (int32_t)-32767);
+
+        //the ratio is the sine of the phase change, asin(x) ~ x + x^3/6
+        //straightens out the larger deviations
+        const int32_t ratio_cubed = (((ratio * ratio) >> 15) * ratio) >> 15;
+        ratio += (ratio_cubed * 5461) >> 15;
+
+        //radians to the units of the cordic phase, pi/32768
+        frequency = (ratio * 10430) >> 15;
+      }
+      frequency_accumulator += frequency;
+      frequency_count ++;
+
+      if(alpha)
+      {
+        const int32_t y = (frequency - fm_deemphasis_y) * alpha + fm_deemphasis_err;
+        fm_deemphasis_err = y & 0x7fff;
+        fm_deemphasis_y += y >> 15;
+        audio[idx] = fm_deemphasis_y;
+      }
+      else
+      {
+        audio[idx] = frequency;
+      }
     }
+    return magnitude_sum;
+}
+
+//narrow CW filters are sharper than the FFT bins, the FFT filter only needs
+//to remove the signals that would alias in the narrow filter
+bool __not_in_flash_func(rx_dsp :: narrow_cw)() const
+{
+  return mode == CW && narrow_filter::suitable(filter_control.low_edge_Hz, filter_control.high_edge_Hz);
 }
 
-int16_t __not_in_flash_func(rx_dsp::squelch)(int16_t audio, int32_t signal_amplitude)
+//the narrow filter taps are designed away from core 1, called by rx::tune
+void rx_dsp :: design_narrow_filter(int16_t low_edge_Hz, int16_t high_edge_Hz)
 {
-    if(signal_amplitude > squelch_threshold) 
-      squelch_time_ms = to_ms_since_boot(get_absolute_time());
-    const uint32_t time_since_active = to_ms_since_boot(get_absolute_time())-squelch_time_ms;
+  if(narrow_filter::suitable(low_edge_Hz, high_edge_Hz))
+  {
+    narrow_filter_inst.design(low_edge_Hz, high_edge_Hz);
+  }
+}
 
-    if(time_since_active < squelch_timeout_ms) 
+//rebuild the FFT filter mask after a change to the pass band, tuning offset or
+//tone controls. The setters only mark the mask stale, it is rebuilt once at
+//the start of the next block, so it is always built on core 1 from a
+//consistent set of settings.
+void __not_in_flash_func(rx_dsp :: update_filter_mask)()
+{
+  s_filter_control control = filter_control;
+
+  //the tone controls can be applied to the bins of the FFT filter when each
+  //frequency of the pass band is demodulated to a single audio frequency.
+  //Not in FM, and not in AM or AMSYNC where boosting the side bands relative
+  //to the carrier would over-modulate the envelope and upset the PLL.
+  const bool tone_controls_in_fft = fft_tone_controls && (mode == LSB || mode == USB || mode == CW);
+  control.deemphasis = tone_controls_in_fft ? deemphasis : 0;
+  control.bass = tone_controls_in_fft ? bass : 0;
+  control.treble = tone_controls_in_fft ? treble : 0;
+  control.audio_shift_Hz = mode == CW ? -cw_sidetone_frequency_Hz : 0;
+
+  if(narrow_cw())
+  {
+    control.low_edge_Hz -= narrow_filter::guard_Hz;
+    control.high_edge_Hz += narrow_filter::guard_Hz;
+  }
+
+  fft_filter_inst.set_mask(control);
+}
+
+void __not_in_flash_func(rx_dsp::squelch)(int16_t audio[], uint16_t num_samples)
+{
+    //decide once per block whether the threshold is reached
+    bool active;
+    if(squelch_type == squelch_snr)
     {
-      return audio;
+      uint32_t signal, noise;
+      fft_filter_inst.get_passband_levels(signal, noise);
+      active = (uint64_t)signal * 16u > (uint64_t)noise * squelch_snr_threshold;
     }
     else
     {
-      return 0;
+      active = signal_amplitude > squelch_threshold;
     }
+
+    //count blocks since the threshold was last reached
+    if(active) squelch_blocks = 0;
+    else if(squelch_blocks < squelch_timeout_blocks) squelch_blocks++;
+
+    //open within one block, close over a few blocks to avoid clicks
+    const bool open = squelch_blocks < squelch_timeout_blocks;
+    const int32_t next_gain = open ? squelch_unity_gain : std::max(squelch_gain - squelch_unity_gain/squelch_release_blocks, (int32_t)0);
+
+    if(squelch_gain == squelch_unity_gain && next_gain == squelch_unity_gain) return;
+    if(squelch_gain == 0 && next_gain == 0)
+    {
+      for(uint16_t idx=0; idx<num_samples; idx++) audio[idx] = 0;
+      return;
+    }
+
+    //ramp the gain linearly across the block
+    const int32_t step = (next_gain - squelch_gain)/num_samples;
+    for(uint16_t idx=0; idx<num_samples; idx++)
+    {
+      squelch_gain += step;
+      audio[idx] = (audio[idx] * squelch_gain) >> 15;
+    }
+    squelch_gain = next_gain;
 }
 
-int16_t __not_in_flash_func(rx_dsp::automatic_gain_control)(int16_t audio_in)
+void __not_in_flash_func(rx_dsp::automatic_gain_control)(int16_t audio[], uint16_t num_samples)
 {
     //Use a leaky max hold to estimate audio power
     //             _
@@ -549,56 +744,77 @@ int16_t __not_in_flash_func(rx_dsp::automatic_gain_control)(int16_t audio_in)
     // Attack is fast so that AGC reacts fast to increases in power
     // Hang time and decay are relatively slow to prevent rapid gain changes
 
-    static const uint8_t extra_bits = 16;
-    int32_t audio = audio_in;
-    const int32_t audio_scaled = audio << extra_bits;
-    if(audio_scaled > max_hold)
-    {
-      //attack
-      max_hold += (audio_scaled - max_hold) >> attack_factor;
-      hang_timer = hang_time;
-    }
-    else if(hang_timer)
-    {
-      //hang
-      hang_timer--;
-    }
-    else if(max_hold > 0)
-    {
-      //decay
-      max_hold -= max_hold>>decay_factor; 
-    }
+    //The envelope and gain are updated once per sub-block. The audio is
+    //delayed by a sub-block, so the gain has already ramped down when a loud
+    //sub-block is output, attack is complete within a sub-block (about 1ms).
 
-    //calculate gain needed to amplify to full scale
-    const int16_t magnitude = max_hold >> extra_bits;
+    static const uint8_t extra_bits = 16;
     const int16_t limit = INT16_MAX; //hard limit
     const int16_t setpoint = limit/2; //about half full scale
 
-    //apply gain
-    if(magnitude > 0)
+    for(uint16_t start=0; start<num_samples; start+=agc_sub_block_size)
     {
-      if(manual_gain_control)
+      int16_t *sub_block = &audio[start];
+
+      //peak of the newest sub-block
+      int32_t peak = 0;
+      for(uint8_t idx=0; idx<agc_sub_block_size; idx++)
       {
-        gain = manual_gain;
+        peak = std::max(peak, (int32_t)abs(sub_block[idx]));
       }
-      else
+      const int32_t peak_scaled = std::min(peak, (int32_t)limit) << extra_bits;
+
+      if(peak_scaled > max_hold)
       {
-        const int16_t agc_gain = setpoint/magnitude;
-        gain = std::min(agc_gain, manual_gain);
+        //attack
+        max_hold = peak_scaled;
+        hang_timer = hang_time;
+      }
+      else if(peak_scaled > max_hold - (max_hold >> 3))
+      {
+        //a steady signal within about 1dB of the max hold restarts the hang
+        hang_timer = hang_time;
+      }
+      else if(hang_timer)
+      {
+        //hang
+        hang_timer = hang_timer > agc_sub_block_size ? hang_timer - agc_sub_block_size : 0;
+      }
+      else if(max_hold > 0)
+      {
+        //decay, the same rate as decay_factor applied to each sample
+        max_hold -= max_hold>>(decay_factor - agc_sub_block_bits);
       }
-      if(gain < 1) gain = 1;
-      audio *= gain;
-    }
 
-    //soft clip (compress)
-    if (audio > setpoint)  audio =  setpoint + ((audio-setpoint)>>1);
-    if (audio < -setpoint) audio = -setpoint - ((audio+setpoint)>>1);
+      //calculate gain needed to amplify to full scale, one division for each
+      //sub-block
+      const int16_t magnitude = max_hold >> extra_bits;
+      int32_t next_gain = (int32_t)manual_gain << agc_gain_bits;
+      if(!manual_gain_control && magnitude > 0)
+      {
+        next_gain = std::min(((int32_t)setpoint << agc_gain_bits)/magnitude, next_gain);
+      }
+      next_gain = std::max(next_gain, (int32_t)1 << agc_gain_bits);
 
-    //hard clamp
-    if (audio > limit)  audio = limit;
-    if (audio < -limit) audio = -limit;
+      //apply gain to the delayed sub-block, ramping to the new gain
+      for(uint8_t idx=0; idx<agc_sub_block_size; idx++)
+      {
+        const int32_t ramp_gain = agc_gain + (((next_gain - agc_gain) * idx) >> agc_sub_block_bits);
+        int32_t sample = ((int32_t)agc_delay[idx] * ramp_gain) >> agc_gain_bits;
+        agc_delay[idx] = sub_block[idx];
 
-    return audio;
+        //soft clip (compress)
+        if (sample > setpoint)  sample =  setpoint + ((sample-setpoint)>>1);
+        if (sample < -setpoint) sample = -setpoint - ((sample+setpoint)>>1);
+
+        //hard clamp
+        if (sample > limit)  sample = limit;
+        if (sample < -limit) sample = -limit;
+
+        sub_block[idx] = sample;
+      }
+      agc_gain = next_gain;
+    }
 }
 
 rx_dsp :: rx_dsp()
@@ -606,6 +822,8 @@ rx_dsp :: rx_dsp()
   //initialise state
   phase = 0;
   frequency=0;
+  cw_sidetone_phase = 0;
+  amsync_reset();
   initialise_luts();
   swap_iq = 0;
   iq_correction = 0;
@@ -613,83 +831,105 @@ rx_dsp :: rx_dsp()
   //initialise semaphore for spectrum
   set_mode(AM, 2);
   sem_init(&spectrum_semaphore, 1, 1);
-  queue_init(&data_queue, 4, 2048);
   set_agc_control(3, 0);
   filter_control.enable_auto_notch = false;
   filter_control.enable_noise_reduction = false;
-  filter_control.noise_smoothing = 10;
+  filter_control.noise_smoothing = 2;
   filter_control.noise_threshold = 1;
   filter_control.spectrum_smoothing = 1;
+  filter_mask_stale = true;
 
   sem_init(&audio_semaphore, 1, 1);
 
   //clear cic filter
-  decimate_count=0;
-  integratori1=0; integratorq1=0;
-  integratori2=0; integratorq2=0;
-  integratori3=0; integratorq3=0;
-  integratori4=0; integratorq4=0;
-  delayi0=0; delayq0=0;
-  delayi1=0; delayq1=0;
-  delayi2=0; delayq2=0;
-  delayi3=0; delayq3=0;
+  cic_i.reset();
+  cic_q.reset();
+
+  #ifdef DSP_PROFILE
+  profile.reset();
+  #endif
 
 }
 
-void rx_dsp :: set_auto_notch(bool enable_auto_notch)
+void __not_in_flash_func(rx_dsp :: set_auto_notch)(bool enable_auto_notch)
 {
   filter_control.enable_auto_notch = enable_auto_notch;
 }
 
-void rx_dsp :: set_spectrum_smoothing(uint8_t spectrum_smoothing)
+void __not_in_flash_func(rx_dsp :: set_shed_features)(uint8_t features)
+{
+  shed_features = features;
+}
+
+uint8_t __not_in_flash_func(rx_dsp :: get_shed_features)() const
+{
+  return shed_features;
+}
+
+void __not_in_flash_func(rx_dsp :: set_spectrum_smoothing)(uint8_t spectrum_smoothing)
 {
   filter_control.spectrum_smoothing = spectrum_smoothing;
 }
 
-void rx_dsp :: set_noise_reduction(bool enable_noise_reduction, int8_t noise_smoothing, int8_t noise_threshold)
+void __not_in_flash_func(rx_dsp :: set_noise_reduction)(bool enable_noise_reduction, int8_t noise_smoothing, int8_t noise_threshold)
 {
   filter_control.enable_noise_reduction = enable_noise_reduction;
   filter_control.noise_smoothing = noise_smoothing;
   filter_control.noise_threshold = noise_threshold;
 }
 
-void rx_dsp :: set_deemphasis(uint8_t deemph)
+void __not_in_flash_func(rx_dsp :: set_deemphasis)(uint8_t deemph)
 {
   deemphasis = deemph;
+  filter_mask_stale = true;
 }
 
-void rx_dsp ::set_treble(uint8_t tr) {
+void __not_in_flash_func(rx_dsp :: set_fm_discriminator)(uint8_t discriminator)
+{
+  fm_discriminator = discriminator;
+}
+
+void __not_in_flash_func(rx_dsp :: set_fft_tone_controls)(bool enable)
+{
+  fft_tone_controls = enable;
+  filter_mask_stale = true;
+}
+
+void __not_in_flash_func(rx_dsp ::set_treble)(uint8_t tr) {
   if (tr > 4) {
     tr = 4;
   }
   treble = tr;
+  filter_mask_stale = true;
 }
 
-void rx_dsp ::set_bass(uint8_t bs) {
+void __not_in_flash_func(rx_dsp ::set_bass)(uint8_t bs) {
   if (bs > 4) {
     bs = 4;
   }
   bass = bs;
+  filter_mask_stale = true;
 }
 
-void rx_dsp ::set_impulse_threshold(uint8_t it) {
+void __not_in_flash_func(rx_dsp ::set_impulse_threshold)(uint8_t it) {
   if (it > 6) {
     it = 6;
   }
   impulse_threshold = it;
 }
 
-void rx_dsp :: set_agc_control(uint8_t agc_control, uint8_t agc_gain)
+void __not_in_flash_func(rx_dsp :: set_agc_control)(uint8_t agc_control, uint8_t agc_gain)
 {
   //input fs=480000.000000 Hz
   //decimation=32 x 2
   //fs=15625.000000 Hz
-  //Setting Decay Time(s) Factor Attack Time(s) Factor  Hang  Timer
-  //======= ============= ====== ============== ======  ====  =====
-  //fast        0.151          10       0.001      2    0.1s   1500
-  //medium      0.302          11       0.001      2    0.25s  3750
-  //slow        0.604          12       0.001      2    1s     15000
-  //long        2.414          14       0.001      2    2s     30000
+  //Setting Decay Time(s) Factor Attack Time(s)  Hang  Timer
+  //======= ============= ====== ==============  ====  =====
+  //fast        0.151          10       0.001     0.1s   1500
+  //medium      0.302          11       0.001     0.25s  3750
+  //slow        0.604          12       0.001     1s     15000
+  //long        2.414          14       0.001     2s     30000
+  //attack is within one sub-block, decay and hang are per sample
 
 
   manual_gain_control = false;
@@ -698,25 +938,21 @@ void rx_dsp :: set_agc_control(uint8_t agc_control, uint8_t agc_gain)
   switch(agc_control)
   {
       case 0: //fast
-        attack_factor=2;
         decay_factor=10;
         hang_time=1500;
         break;
 
       case 1: //medium
-        attack_factor=2;
         decay_factor=11;
         hang_time=3750;
         break;
 
       case 2: //slow
-        attack_factor=2;
         decay_factor=12;
         hang_time=15000;
         break;
 
       case 3: //long
-        attack_factor=2;
         decay_factor=14;
         hang_time=30000;
         break;
@@ -727,56 +963,89 @@ void rx_dsp :: set_agc_control(uint8_t agc_control, uint8_t agc_gain)
   }
 }
 
-void rx_dsp :: set_frequency_offset_Hz(double offset_frequency)
+void __not_in_flash_func(rx_dsp :: set_frequency_offset_Hz)(double offset_frequency)
 {
   offset_frequency_Hz = offset_frequency;
-  const float bin_width = adc_sample_rate/(cic_decimation_rate*256);
+  const float bin_width = (float)adc_sample_rate/(cic_decimation_rate*fft_size);
   filter_control.fft_bin = offset_frequency/bin_width;
   frequency = ((double)(1ull<<32)*offset_frequency)*cic_decimation_rate/(adc_sample_rate);
+  filter_mask_stale = true;
 }
 
 
-void rx_dsp :: set_mode(uint8_t val, uint8_t bw)
+void __not_in_flash_func(rx_dsp :: set_mode)(uint8_t val, uint8_t bw, uint16_t width_Hz, int16_t shift_Hz)
 {
   mode = val;
-  //                           AM AMS LSB USB NFM CW
-  uint8_t start_bins[6]   =  {  0,  0,  3,  3,  0, 0};
+  get_passband_Hz(mode, bw, width_Hz, shift_Hz, filter_control.low_edge_Hz, filter_control.high_edge_Hz);
+  filter_mask_stale = true;
+}
 
-  uint8_t stop_bins[5][6] = {{ 19, 19, 16, 16, 31, 0},  //very narrow
-                             { 22, 22, 19, 19, 34, 1},  //narrow
-                             { 25, 25, 22, 22, 37, 2},  //normal
-                             { 31, 31, 25, 25, 40, 3},  //wide
-                             { 63, 63, 28, 28, 43, 4}}; //very wide
+//pass band edges relative to the tuned frequency, also used by rx::tune to
+//check that the whole pass band fits in the IF
+void __not_in_flash_func(rx_dsp :: get_passband_Hz)(uint8_t mode, uint8_t bw, uint16_t width_Hz, int16_t shift_Hz, int16_t &low_edge_Hz, int16_t &high_edge_Hz)
+{
+  //pass band edges in Hz, the presets are the edges of the original 117Hz bins
+  //                                                    AM   AMS   LSB   USB   NFM   CW
+  static const uint16_t __not_in_flash("start_Hz") start_Hz[6]   = {    0,    0,  293,  293,    0,   0};
+
+  static const uint16_t __not_in_flash("stop_Hz") stop_Hz[5][6] = {{ 2285, 2285, 1934, 1934, 3691,  59},  //very narrow
+                                                                    { 2637, 2637, 2285, 2285, 4043, 176},  //narrow
+                                                                    { 2988, 2988, 2637, 2637, 4395, 293},  //normal
+                                                                    { 3691, 3691, 2988, 2988, 4746, 410},  //wide
+                                                                    { 7441, 7441, 3340, 3340, 5098, 527}}; //very wide
+
+  //a width overrides the preset, sidebands are measured from the start edge,
+  //double sideband modes are centred on the carrier
+  int16_t low_Hz = start_Hz[mode];
+  int16_t high_Hz = stop_Hz[bw][mode];
+  if(width_Hz)
+  {
+    high_Hz = low_Hz ? low_Hz + width_Hz : width_Hz/2;
+  }
 
-  filter_control.lower_sideband = (mode != USB);
-  filter_control.upper_sideband = (mode != LSB);
-  filter_control.start_bin = start_bins[mode];
-  filter_control.stop_bin = stop_bins[bw][mode];
+  //IF shift moves the pass band up in audio frequency, which is down in RF
+  //frequency for LSB
+  if(mode == USB)
+  {
+    low_edge_Hz = low_Hz + shift_Hz;
+    high_edge_Hz = high_Hz + shift_Hz;
+  }
+  else if(mode == LSB)
+  {
+    low_edge_Hz = -high_Hz - shift_Hz;
+    high_edge_Hz = -low_Hz - shift_Hz;
+  }
+  else
+  {
+    low_edge_Hz = -high_Hz + shift_Hz;
+    high_edge_Hz = high_Hz + shift_Hz;
+  }
 }
 
-void rx_dsp :: set_swap_iq(uint8_t val)
+void __not_in_flash_func(rx_dsp :: set_swap_iq)(uint8_t val)
 {
   swap_iq = val;
 }
 
-void rx_dsp :: set_iq_correction(uint8_t val)
+void __not_in_flash_func(rx_dsp :: set_iq_correction)(uint8_t val)
 {
   iq_correction = val;
 }
 
-void rx_dsp :: set_cw_sidetone_Hz(uint16_t val)
+void __not_in_flash_func(rx_dsp :: set_cw_sidetone_Hz)(uint16_t val)
 {
   cw_sidetone_frequency_Hz = val;
+  filter_mask_stale = true;
 }
 
-void rx_dsp :: set_gain_cal_dB(uint16_t val)
+void __not_in_flash_func(rx_dsp :: set_gain_cal_dB)(uint16_t val)
 {
   amplifier_gain_dB = val;
   s9_threshold = full_scale_signal_strength*powf(10.0f, (S9 - full_scale_dBm + amplifier_gain_dB)/20.0f);
 }
 
 //set_squelch
-void rx_dsp :: set_squelch(uint8_t threshold, uint8_t timeout)
+void __not_in_flash_func(rx_dsp :: set_squelch)(uint8_t threshold, uint8_t timeout, uint8_t type)
 {
   //0-9 = s0 to s9, 10 to 12 = S9+10dB to S9+30dB
   const int16_t thresholds[] = {
@@ -794,14 +1063,19 @@ void rx_dsp :: set_squelch(uint8_t threshold, uint8_t timeout)
     (int16_t)(s9_threshold*10), //s9+20dB
     (int16_t)(s9_threshold*31), //s9+30dB
   };
-  const uint16_t timeouts[] = {
+  static const uint16_t __not_in_flash("squelch_timeouts") timeouts[] = {
     50, 100, 200, 500, 1000, 2000, 3000, 5000
   };
+  squelch_type = type;
   squelch_threshold = thresholds[threshold];
-  squelch_timeout_ms = timeouts[timeout];
+  squelch_snr_threshold = roundf(16.0f * powf(10.0f, squelch_snr_dB[threshold]/20.0f));
+
+  //round the timeout up to whole blocks
+  const uint32_t block_ms_x1000 = 1000000u * (adc_block_size/decimation_rate) / audio_sample_rate;
+  squelch_timeout_blocks = (timeouts[timeout] * 1000u + block_ms_x1000 - 1) / block_ms_x1000;
 }
 
-int16_t rx_dsp :: get_signal_strength_dBm()
+int16_t __not_in_flash_func(rx_dsp :: get_signal_strength_dBm)()
 {
   if(signal_amplitude == 0)
   {
@@ -811,19 +1085,31 @@ int16_t rx_dsp :: get_signal_strength_dBm()
   return roundf(full_scale_dBm - amplifier_gain_dB + signal_strength_dBFS);
 }
 
-s_filter_control rx_dsp :: get_filter_config()
+//(signal + noise)/noise in the pass band, using the noise floor of each bin
+int16_t __not_in_flash_func(rx_dsp :: get_snr_dB)()
+{
+  uint32_t signal, noise;
+  fft_filter_inst.get_passband_levels(signal, noise);
+  if(noise == 0 || signal <= noise)
+  {
+    return 0;
+  }
+  return roundf(20.0f*log10f((float)signal / noise));
+}
+
+s_filter_control __not_in_flash_func(rx_dsp :: get_filter_config)()
 {
   return capture_filter_control;
 }
 
-static inline int8_t freq_bin(uint8_t bin)
+static inline int16_t freq_bin(uint16_t bin)
 {
-  return bin > 127 ? bin - 256 : bin;
+  return bin >= fft_size/2 ? bin - fft_size : bin;
 }
 
-static inline uint8_t fft_shift(uint8_t bin)
+static inline uint16_t fft_shift(uint16_t bin)
 {
-  return bin ^ 0x80;
+  return bin ^ (fft_size/2);
 }
 
 void rx_dsp :: get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom)
@@ -837,9 +1123,9 @@ void rx_dsp :: get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom)
   uint16_t new_max=0u;
   static uint16_t min=1u;//long term maximum
   uint16_t new_min=65535u;
-  for(uint16_t i=0; i<256; ++i)
+  for(uint16_t i=0; i<fft_size; ++i)
   {
-    const uint16_t magnitude = cic_correct(freq_bin(i), capture_filter_control.fft_bin, capture[i]);
+    const uint16_t magnitude = fft_filter_inst.cic_correct(freq_bin(i), capture_filter_control.fft_bin, capture[i]);
     if(magnitude == 0) continue;
     new_max = std::max(magnitude, new_max);
     new_min = std::min(magnitude, new_min);
@@ -850,10 +1136,10 @@ void rx_dsp :: get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom)
   const float logmax = log10f(std::max(max, lowest_max));
 
   //clamp and convert to log scale 0 -> 255
-  uint8_t temp_spectrum[256];
-  for(uint16_t i=0; i<256; ++i)
+  uint8_t temp_spectrum[fft_size];
+  for(uint16_t i=0; i<fft_size; ++i)
   {
-    const uint16_t magnitude = cic_correct(freq_bin(i), capture_filter_control.fft_bin, capture[i]);
+    const uint16_t magnitude = fft_filter_inst.cic_correct(freq_bin(i), capture_filter_control.fft_bin, capture[i]);
     if(magnitude == 0)
     {
       temp_spectrum[fft_shift(i)] = 0u;
@@ -864,14 +1150,21 @@ void rx_dsp :: get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom)
     }
   }
 
-  //zoom
+  //zoom, the display is 256 points wide, so larger FFTs show the strongest
+  //of the bins under each point until zoomed in
+  const int16_t bins_per_point = std::max(fft_size/(256*zoom), 1);
   for(int16_t i=0; i<256; ++i)
   {
     uint16_t total = 0;
     for(int16_t j=0; j<zoom; j++)
     {
-      int16_t from_idx = ((i+j-zoom/2-128)/zoom)+128;
-      total += temp_spectrum[from_idx];
+      int16_t from_idx = ((int32_t)(i+j-zoom/2-128)*fft_size/256/zoom)+fft_size/2;
+      uint8_t level = 0;
+      for(int16_t k=0; k<bins_per_point && from_idx+k<fft_size; k++)
+      {
+        level = std::max(level, temp_spectrum[from_idx+k]);
+      }
+      total += level;
     }
     spectrum[i] = total/zoom;
   }
@@ -909,7 +1202,7 @@ void rx_dsp :: get_audio_capture(uint8_t audio[])
 
   sem_acquire_blocking(&audio_semaphore);
   for (uint16_t i = 0; i < (sizeof(audio_in) / sizeof(audio_in[0])); i++) {
-    audio_in[i] = audio_capture[(audio_capture_idx * 16 + i) % 128];
+    audio_in[i] = audio_capture[(audio_capture_idx * audio_capture_block + i) % 128];
   }
   sem_release(&audio_semaphore);
   const uint16_t x = audio_correlate(audio_in, prev_audio);
@@ -928,19 +1221,31 @@ void rx_dsp :: get_audio_capture(uint8_t audio[])
 
 uint32_t rx_dsp::get_iq_buffer_level()
 {
-  return queue_get_level(&data_queue);
+  return iq_ring.get_level();
+}
+
+uint32_t rx_dsp::get_iq_buffer_overflows()
+{
+  return iq_ring.get_overflows();
+}
+
+uint32_t rx_dsp::get_iq_buffer_high_water_mark()
+{
+  return iq_ring.get_high_water_mark();
+}
+
+//samples remain valid until they are consumed
+uint32_t rx_dsp::peek_raw_data(const s_iq_sample *&samples)
+{
+  return iq_ring.peek_span(samples);
 }
 
-bool rx_dsp::get_raw_data(int16_t &i, int16_t &q)
+void rx_dsp::consume_raw_data(uint32_t num_samples)
 {
-  uint32_t data;
-  bool success = queue_try_remove(&data_queue, &data);
-  i = (data >> 16) & 0xffff;
-  q = data & 0xffff;
-  return success;
+  iq_ring.consume(num_samples);
 }
 
-float rx_dsp::get_tuning_offset_Hz()
+float __not_in_flash_func(rx_dsp::get_tuning_offset_Hz)()
 {
 
   if(frequency_count > 30000)
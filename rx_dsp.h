@@ -4,9 +4,49 @@
 #include <stdint.h>
 #include "rx_definitions.h"
 #include "pico/sem.h"
-#include "pico/util/queue.h"
 #include "fft_filter.h"
+#include "narrow_filter.h"
+#include "cordic.h"
+#include "cic_decimator.h"
 #include "ring_buffer_lib.h"
+#include "spsc_ring.h"
+#include "dsp_profile.h"
+
+struct s_iq_sample
+{
+  int16_t i;
+  int16_t q;
+};
+
+//optional features that can be shed temporarily when the DSP is overloaded,
+//in the order that they are shed
+enum e_shed_feature
+{
+  shed_noise_reduction = 1,
+  shed_auto_notch = 2,
+  shed_spectrum = 4,
+  shed_iq_correction = 8,
+  shed_num_features = 4
+};
+
+//the squelch opens on the signal strength, or on (signal + noise)/noise in
+//the pass band of the FFT filter
+enum e_squelch_type
+{
+  squelch_signal_strength = 0,
+  squelch_snr = 1
+};
+
+//the FM discriminator differences the cordic phase, or divides the cross
+//product of successive samples by the power
+enum e_fm_discriminator
+{
+  fm_discriminator_phase = 0,
+  fm_discriminator_product = 1
+};
+
+//SNR squelch thresholds in dB, for the same settings as S0 to S9+30dB
+const uint8_t squelch_snr_dB[13] = {0, 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25};
 
 typedef struct {
   int32_t phase_locked;
@@ -25,47 +65,65 @@ class rx_dsp
   uint16_t process_block(uint16_t samples[], int16_t audio_samples[], ring_buffer_t *iq_samples);
   void set_frequency_offset_Hz(double offset_frequency);
   void set_agc_control(uint8_t agc_control, uint8_t agc_gain);
-  void set_mode(uint8_t mode, uint8_t bw);
+  void set_mode(uint8_t mode, uint8_t bw, uint16_t width_Hz=0, int16_t shift_Hz=0);
+  void design_narrow_filter(int16_t low_edge_Hz, int16_t high_edge_Hz);
+  static void get_passband_Hz(uint8_t mode, uint8_t bw, uint16_t width_Hz, int16_t shift_Hz, int16_t &low_edge_Hz, int16_t &high_edge_Hz);
   void set_cw_sidetone_Hz(uint16_t val);
   void set_gain_cal_dB(uint16_t val);
-  void set_squelch(uint8_t threshold, uint8_t timeout);
+  void set_squelch(uint8_t threshold, uint8_t timeout, uint8_t type = squelch_signal_strength);
   void set_swap_iq(uint8_t val);
   void set_iq_correction(uint8_t val);
   void set_deemphasis(uint8_t deemph);
+  void set_fft_tone_controls(bool enable);
+  void set_fm_discriminator(uint8_t discriminator);
   void set_treble(uint8_t tr);
   void set_bass(uint8_t bs);
   void set_impulse_threshold(uint8_t it);
+  void set_shed_features(uint8_t features);
+  uint8_t get_shed_features() const;
   void set_auto_notch(bool enable_auto_notch);
   void set_noise_reduction(bool enable_noise_reduction, int8_t noise_smoothing, int8_t noise_threshold);
   void set_spectrum_smoothing(uint8_t spectrum_smoothing);
   int16_t get_signal_strength_dBm();
+  int16_t get_snr_dB();
   void get_spectrum(uint8_t spectrum[], uint8_t &dB10, uint8_t zoom);
   void get_audio_capture(uint8_t audio[]);
   s_filter_control get_filter_config();
   void get_spectrum(float spectrum[]);
-  bool get_raw_data(int16_t &i, int16_t &q);
+  uint32_t peek_raw_data(const s_iq_sample *&samples);
+  void consume_raw_data(uint32_t num_samples);
   uint32_t get_iq_buffer_level();
+  uint32_t get_iq_buffer_overflows();
+  uint32_t get_iq_buffer_high_water_mark();
   float get_tuning_offset_Hz();
   void amsync_reset(void);
 
+  #ifdef DSP_PROFILE
+  s_dsp_profile profile;
+  #endif
+
   private:
   
   void frequency_shift(int16_t &i, int16_t &q);
-  bool decimate(int16_t &i, int16_t &q);
-  int16_t demodulate(int16_t i, int16_t q, uint16_t mag, int16_t phi);
-  int16_t automatic_gain_control(int16_t audio);
+  template<uint8_t demod_mode> int32_t demodulate_block(int16_t iq[], int16_t audio[], uint16_t num_samples);
+  int16_t demodulate_amsync(int16_t i, int16_t q);
+  int32_t demodulate_fm(int16_t iq[], int16_t audio[], uint16_t num_samples);
+  bool narrow_cw() const;
+  void update_filter_mask();
+  void measure_tuning_offset(const int16_t iq[], uint16_t num_samples);
+  void automatic_gain_control(int16_t audio[], uint16_t num_samples);
   int16_t apply_deemphasis(int16_t x);
-  int16_t squelch(int16_t audio, int32_t amplitude);
+  void squelch(int16_t audio[], uint16_t num_samples);
   int16_t apply_treble(int16_t x);
   int16_t apply_bass(int16_t x);
   void apply_impulse_blanker(int16_t &i, int16_t &q, uint16_t mag);
   void iq_imbalance_correction(int16_t &i, int16_t &q);
 
   //capture samples for decoding
-  queue_t data_queue;
+  spsc_ring<s_iq_sample, 2048> iq_ring;
 
   //capture samples for spectral analysis
-  int16_t capture[256];
+  int16_t capture[fft_size];
   semaphore_t spectrum_semaphore;
 
   //capture samples for waveform display
@@ -74,25 +132,23 @@ class rx_dsp
   semaphore_t audio_semaphore;
 
   //used in cic decimator
-  uint8_t decimate_count;
-  int32_t integratori1, integratorq1;
-  int32_t integratori2, integratorq2;
-  int32_t integratori3, integratorq3;
-  int32_t integratori4, integratorq4;
-  int32_t delayi0, delayq0;
-  int32_t delayi1, delayq1;
-  int32_t delayi2, delayq2;
-  int32_t delayi3, delayq3;
+  cic_decimator cic_i;
+  cic_decimator cic_q;
 
   //used in fft filter
   int16_t fft_bin;
-  fft_filter fft_filter_inst;
-  s_filter_control filter_control;
-  s_filter_control capture_filter_control;
+  fft_filter<fft_order> fft_filter_inst;
+  s_filter_control filter_control = {};
+  s_filter_control capture_filter_control = {};
+  bool filter_mask_stale = true;
+
+  //used for narrow CW filters
+  narrow_filter narrow_filter_inst;
 
   //used in frequency shifter
   uint8_t swap_iq;
   uint8_t iq_correction;
+  uint8_t shed_features = 0;
   int32_t offset_frequency_Hz;
   int32_t dither;
   uint32_t phase;
@@ -108,12 +164,24 @@ class rx_dsp
 
   int32_t signal_amplitude;
 
-  //used in demodulator
+  //used in demodulator, 6 iterations measure the phase to within 1 degree
+  typedef cordic<6> polar_cordic;
+  //the same magnitude for the blanker and signal strength in the other modes
+  typedef cordic<6, int32_t, cordic_magnitude> magnitude_cordic;
+  //the tuning offset is averaged over many samples, so is measured finely
+  typedef cordic<14, int32_t, cordic_phase> offset_cordic;
   int32_t mode=0;
   int32_t audio_dc=0;
   uint8_t ssb_phase=0;
   int16_t last_phase=0;
 
+  //used in the product FM discriminator
+  uint8_t fm_discriminator = fm_discriminator_phase;
+  int32_t fm_last_i = 0;
+  int32_t fm_last_q = 0;
+  int32_t fm_deemphasis_y = 0;
+  int32_t fm_deemphasis_err = 0;
+
   // de-emphasis
   uint8_t deemphasis=0;
 
@@ -123,22 +191,35 @@ class rx_dsp
   //bass
   uint8_t bass = 0;
 
+  //apply de-emphasis, bass and treble in the FFT filter rather than to each
+  //audio sample, where the mode allows
+  bool fft_tone_controls = true;
+
   // impulse blanker threshold
   uint8_t impulse_threshold;
 
-  //squelch
+  //squelch, evaluated once per block with the timeout counted in blocks
+  static const uint8_t squelch_release_blocks = 4;
+  static const int32_t squelch_unity_gain = 1 << 15;
+  uint8_t squelch_type = squelch_signal_strength;
   int16_t squelch_threshold=0;
+  uint16_t squelch_snr_threshold=0; //(signal + noise)/noise x16
   int16_t s9_threshold=0;
-  uint32_t squelch_time_ms = 0;
-  uint32_t squelch_timeout_ms = 0;
-
-  //used in AGC
-  uint8_t attack_factor;
+  uint16_t squelch_blocks = 0; //blocks since the squelch threshold was reached
+  uint16_t squelch_timeout_blocks = 0;
+  int32_t squelch_gain = squelch_unity_gain;
+
+  //used in AGC, the gain is updated once per sub-block
+  static const uint8_t agc_sub_block_bits = 4;
+  static const uint8_t agc_sub_block_size = 1 << agc_sub_block_bits;
+  static const uint8_t agc_gain_bits = 6;
+  static_assert((adc_block_size/decimation_rate) % agc_sub_block_size == 0, "AGC sub-blocks must fit in a block");
   uint8_t decay_factor;
   uint16_t hang_time;
-  uint16_t hang_timer;
-  int32_t max_hold;
-  int16_t gain;
+  uint16_t hang_timer = 0;
+  int32_t max_hold = 0;
+  int32_t agc_gain = 1 << agc_gain_bits;
+  int16_t agc_delay[agc_sub_block_size] = {};
   int16_t manual_gain;
   bool manual_gain_control = false;
 
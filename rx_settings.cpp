@@ -0,0 +1,148 @@
+#include "rx_settings.h"
+#include "pico.h"
+
+//only the fields that differ from the last applied snapshot are written
+bool __not_in_flash_func(apply_dsp_settings)(rx_dsp &dsp, const rx_settings &settings, const rx_settings &old, bool apply_all)
+{
+  #define CHANGED(field) (apply_all || (settings.field != old.field))
+
+  //switching between internal and external nco changes the system clock
+  const bool restart = apply_all ? settings.enable_external_nco : CHANGED(enable_external_nco);
+
+  //apply frequency offset
+  if(CHANGED(offset_frequency_Hz))
+  {
+    dsp.set_frequency_offset_Hz(settings.offset_frequency_Hz);
+  }
+
+  //apply CW sidetone
+  if(CHANGED(cw_sidetone_Hz))
+  {
+    dsp.set_cw_sidetone_Hz(settings.cw_sidetone_Hz);
+  }
+
+  //apply gain calibration (squelch thresholds depend on it)
+  if(CHANGED(gain_cal))
+  {
+    dsp.set_gain_cal_dB(settings.gain_cal);
+  }
+
+  //apply AGC control
+  if(CHANGED(agc_setting) || CHANGED(agc_gain))
+  {
+    dsp.set_agc_control(settings.agc_setting, settings.agc_gain);
+  }
+
+  //apply Automatic Notch Filter
+  if(CHANGED(enable_auto_notch))
+  {
+    dsp.set_auto_notch(settings.enable_auto_notch);
+  }
+
+  //apply Spectrum Smoothing
+  if(CHANGED(spectrum_smoothing))
+  {
+    dsp.set_spectrum_smoothing(settings.spectrum_smoothing);
+  }
+
+  //apply Noise Reduction
+  if(CHANGED(enable_noise_reduction) || CHANGED(noise_estimation) || CHANGED(noise_threshold))
+  {
+    dsp.set_noise_reduction(settings.enable_noise_reduction, settings.noise_estimation, settings.noise_threshold);
+  }
+
+  //apply mode
+  if(CHANGED(mode) || CHANGED(bandwidth) || CHANGED(filter_width_Hz) || CHANGED(if_shift_Hz))
+  {
+    dsp.set_mode(settings.mode, settings.bandwidth, settings.filter_width_Hz, settings.if_shift_Hz);
+  }
+
+  //apply deemphasis
+  if(CHANGED(deemphasis))
+  {
+    dsp.set_deemphasis(settings.deemphasis);
+  }
+
+  //apply FM discriminator
+  if(CHANGED(fm_discriminator))
+  {
+    dsp.set_fm_discriminator(settings.fm_discriminator);
+  }
+
+  //apply treble
+  if(CHANGED(treble))
+  {
+    dsp.set_treble(settings.treble);
+  }
+
+  //apply bass
+  if(CHANGED(bass))
+  {
+    dsp.set_bass(settings.bass);
+  }
+
+  //apply tone controls in the FFT filter or to each audio sample
+  if(CHANGED(fft_tone_controls))
+  {
+    dsp.set_fft_tone_controls(settings.fft_tone_controls);
+  }
+
+  //apply impulse blanker threshold
+  if(CHANGED(impulse_threshold))
+  {
+    dsp.set_impulse_threshold(settings.impulse_threshold);
+  }
+
+  //apply squelch
+  if(CHANGED(squelch_threshold) || CHANGED(squelch_timeout) || CHANGED(squelch_type) || CHANGED(gain_cal))
+  {
+    dsp.set_squelch(settings.squelch_threshold, settings.squelch_timeout, settings.squelch_type);
+  }
+
+  //apply swap iq
+  if(CHANGED(swap_iq))
+  {
+    dsp.set_swap_iq(settings.swap_iq);
+  }
+
+  //apply iq imbalance correction
+  if(CHANGED(iq_correction))
+  {
+    dsp.set_iq_correction(settings.iq_correction);
+  }
+
+  #undef CHANGED
+  return restart;
+}
+
+//called from core 0
+void settings_snapshot::publish(const rx_settings &settings)
+{
+  const uint32_t sequence = settings_sequence.load(std::memory_order_relaxed) + 1;
+  std::atomic_thread_fence(std::memory_order_release);
+  settings_buffer[sequence & 1] = settings;
+  settings_sequence.store(sequence, std::memory_order_release);
+}
+
+//called from core 1, never blocks, returns false if there is no new snapshot
+//or it was being overwritten while it was copied (try again at the next
+//block). Nothing has been applied before the first snapshot.
+bool __not_in_flash_func(settings_snapshot::read)(rx_settings &settings, bool &first)
+{
+  const uint32_t sequence = settings_sequence.load(std::memory_order_acquire);
+  if(sequence == applied_sequence) return false;
+  settings = settings_buffer[sequence & 1];
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(settings_sequence.load(std::memory_order_relaxed) != sequence) return false;
+  first = (applied_sequence == 0);
+  applied_sequence = sequence;
+  return true;
+}
+
+//keep the applied snapshot to compare with the next, and count the changes
+//that were made without restarting the stream
+void __not_in_flash_func(settings_snapshot::applied)(const rx_settings &settings, bool first, bool restart)
+{
+  applied_settings = settings;
+  if(!restart && !first) restarts_avoided++;
+}
@@ -0,0 +1,81 @@
+#ifndef RX_SETTINGS__
+#define RX_SETTINGS__
+
+#include <cstdint>
+#include <atomic>
+
+#include "rx_dsp.h"
+
+struct rx_settings
+{
+  double tuned_frequency_Hz;
+  int step_Hz;
+  uint8_t agc_setting;
+  uint8_t agc_gain;
+  uint8_t mode;
+  uint8_t volume;
+  uint8_t squelch_threshold;
+  uint8_t squelch_timeout;
+  uint8_t squelch_type;
+  uint8_t fm_discriminator;
+  bool fft_tone_controls;
+  uint8_t bandwidth;
+  uint16_t filter_width_Hz;
+  int16_t if_shift_Hz;
+  uint8_t deemphasis;
+  uint8_t treble;
+  uint8_t bass;
+  uint16_t cw_sidetone_Hz;
+  uint16_t gain_cal;
+  uint8_t band_1_limit;
+  uint8_t band_2_limit;
+  uint8_t band_3_limit;
+  uint8_t band_4_limit;
+  uint8_t band_5_limit;
+  uint8_t band_6_limit;
+  uint8_t band_7_limit;
+  uint8_t impulse_threshold;
+  int8_t ppm;
+  bool suspend;
+  bool swap_iq;
+  bool iq_correction;
+  bool enable_auto_notch;
+  bool enable_noise_reduction;
+  uint8_t noise_estimation;
+  uint8_t noise_threshold;
+  uint8_t if_frequency_hz_over_100;
+  uint8_t if_mode;
+  uint8_t spectrum_smoothing;
+  uint8_t tuning_option;
+  bool enable_external_nco;
+  bool stream_raw_iq;
+
+  //not a user setting, the offset of the tuned frequency from the nco is set
+  //by rx::tune on core 0
+  double offset_frequency_Hz;
+};
+
+//apply the settings that differ from old to the DSP (all of them if
+//apply_all), returns true if the change can't be applied while streaming and
+//the receiver needs to be restarted
+bool apply_dsp_settings(rx_dsp &dsp, const rx_settings &settings, const rx_settings &old, bool apply_all);
+
+//settings are published by core 0 into alternate buffers (seqlock style),
+//core 1 takes a snapshot at a block boundary and applies only the changes
+class settings_snapshot
+{
+  rx_settings settings_buffer[2];
+  std::atomic<uint32_t> settings_sequence{0};
+  uint32_t applied_sequence = 0;
+  rx_settings applied_settings = {};
+  uint32_t restarts_avoided = 0;
+
+  public:
+  void publish(const rx_settings &settings);
+  bool read(rx_settings &settings, bool &first);
+  void applied(const rx_settings &settings, bool first, bool restart);
+  const rx_settings &get_applied() const { return applied_settings; }
+  uint32_t get_restarts_avoided() const { return restarts_avoided; }
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include <hardware/flash.h>
 #include "pico/multicore.h"
 #include <cstring>
+#include <cstdlib>
+#include <cstddef>
 
 void apply_settings_to_rx(rx & receiver, rx_settings & rx_settings, s_settings & settings, bool suspend, bool settings_changed)
 {
@@ -35,7 +37,7 @@ void apply_settings_to_rx(rx & receiver, rx_settings & rx_settings, s_settings &
   rx_settings.iq_correction = settings.global.iq_correction;
   rx_settings.if_mode = settings.global.if_mode;
   rx_settings.if_frequency_hz_over_100 = settings.global.if_frequency_hz_over_100;
-  rx_settings.noise_estimation = settings.global.noise_estimation + 8;
+  rx_settings.noise_estimation = settings.global.noise_estimation;
   rx_settings.noise_threshold = settings.global.noise_threshold;
   rx_settings.spectrum_smoothing = settings.global.spectrum_smoothing;
   rx_settings.enable_external_nco = settings.global.enable_external_nco;
@@ -44,6 +46,11 @@ void apply_settings_to_rx(rx & receiver, rx_settings & rx_settings, s_settings &
   rx_settings.stream_raw_iq = settings.global.usb_stream;
   rx_settings.tuning_option = settings.global.tuning_option;
   rx_settings.impulse_threshold = settings.global.impulse_threshold;
+  rx_settings.filter_width_Hz = settings.global.filter_width*50;
+  rx_settings.if_shift_Hz = settings.global.if_shift*50;
+  rx_settings.squelch_type = settings.global.squelch_type;
+  rx_settings.fm_discriminator = settings.global.fm_discriminator;
+  rx_settings.fft_tone_controls = settings.global.tone_controls;
   receiver.release();
 }
 
@@ -56,6 +63,34 @@ s_memory_channel get_channel(uint16_t channel_number)
   return memory_channel;
 }
 
+//When the core 1 streaming path is built to run from RAM (PICORX_RAM_DSP),
+//the receiver keeps running while flash is written. Only core 0 interrupts
+//are disabled, the DMA interrupt belongs to core 1 (see rx::run), and USB
+//audio is paused because TinyUSB runs from flash.
+//Otherwise the receiver is suspended and core 1 is halted.
+static uint32_t flash_write_start(s_settings & settings, rx & receiver, rx_settings & rx_settings)
+{
+#ifdef PICORX_RAM_DSP
+  receiver.pause_usb(true);
+#else
+  apply_settings_to_rx(receiver, rx_settings, settings, true, false); //suspend rx to disable all DMA transfers
+  sleep_us(10000);                                    //wait for suspension to take effect
+  multicore_lockout_start_blocking();                  //halt the second core
+#endif
+  return save_and_disable_interrupts();                //disable all interrupts
+}
+
+static void flash_write_end(uint32_t ints, s_settings & settings, rx & receiver, rx_settings & rx_settings)
+{
+  restore_interrupts (ints);                           //restore interrupts
+#ifdef PICORX_RAM_DSP
+  receiver.pause_usb(false);
+#else
+  multicore_lockout_end_blocking();                    //restart the second core
+  apply_settings_to_rx(receiver, rx_settings, settings, false, false); //resume rx operation
+#endif
+}
+
 void memory_store_channel(s_memory_channel memory_channel, uint16_t channel_number, s_settings & settings, rx & receiver, rx_settings & rx_settings)
 {
   static_assert(sizeof(s_memory_channel) < memory_chan_size*4);
@@ -87,10 +122,7 @@ void memory_store_channel(s_memory_channel memory_channel, uint16_t channel_numb
 
   //!!! PICO is **very** fussy about flash erasing, there must be no code running in flash.  !!!
   //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  apply_settings_to_rx(receiver, rx_settings, settings, true, false); //suspend rx to disable all DMA transfers
-  sleep_us(10000);                                    //wait for suspension to take effect
-  multicore_lockout_start_blocking();                  //halt the second core
-  const uint32_t ints = save_and_disable_interrupts(); //disable all interrupts
+  const uint32_t ints = flash_write_start(settings, receiver, rx_settings);
 
   //safe to erase flash here
   //--------------------------------------------------------------------------------------------
@@ -98,21 +130,235 @@ void memory_store_channel(s_memory_channel memory_channel, uint16_t channel_numb
   flash_range_program(flash_address, (const uint8_t*)&sector_copy, FLASH_SECTOR_SIZE);
   //--------------------------------------------------------------------------------------------
 
-  restore_interrupts (ints);                           //restore interrupts
-  multicore_lockout_end_blocking();                    //restart the second core
-  apply_settings_to_rx(receiver, rx_settings, settings, false, false); //resume rx operation
+  flash_write_end(ints, settings, receiver, rx_settings);
   //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
   //!!! Normal operation resumed
       
 }
 
 
+//Autosave is a journal of 256 byte flash pages. Each save programs the next
+//page in turn, there is no read-modify-write of a whole sector. Each record
+//holds a magic number, a sequence number and a CRC. Because pages are written
+//in order, the latest record can be found with a binary search rather than a
+//linear scan. If the journal doesn't look as expected (e.g. a corrupt page),
+//it falls back to the linear scan.
+//
+//The flash endurance may not be more than 100000 erase cycles, each sector is
+//erased once every 256 saves. The sector ahead of the next write is erased
+//one at a time by autosave_erase_ahead when the UI is idle.
+static const uint32_t autosave_page_words = FLASH_PAGE_SIZE/sizeof(uint32_t);
+static const uint32_t autosave_num_pages = sizeof(autosave_memory)/FLASH_PAGE_SIZE;
+static const uint32_t autosave_pages_per_sector = FLASH_SECTOR_SIZE/FLASH_PAGE_SIZE;
+static const uint32_t autosave_num_sectors = autosave_num_pages/autosave_pages_per_sector;
+
+static const uint32_t autosave_magic = 0x50525853;
+
+struct s_autosave_record
+{
+  uint32_t magic;
+  uint32_t sequence; //0xffffffff when erased
+  uint32_t crc;
+  uint32_t data[autosave_page_words - 3];
+};
+static_assert(sizeof(s_autosave_record) == FLASH_PAGE_SIZE);
+static_assert(sizeof(s_settings) <= sizeof(s_autosave_record::data));
+
+//check the sector ahead of the next write after each save, and once at boot
+static bool autosave_erase_pending = true;
+
+static const s_autosave_record *autosave_page(uint32_t page)
+{
+  return (const s_autosave_record *)(&autosave_memory[0][0] + page*autosave_page_words);
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t data[], uint32_t num_bytes)
+{
+  //reflected, polynomial 0xedb88320
+  for(uint32_t idx = 0; idx < num_bytes; idx++)
+  {
+    crc ^= data[idx];
+    for(uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return crc;
+}
+
+static uint32_t autosave_crc(const s_autosave_record &record)
+{
+  uint32_t crc = 0xffffffff;
+  crc = crc32(crc, (const uint8_t*)&record.sequence, sizeof(record.sequence));
+  crc = crc32(crc, (const uint8_t*)record.data, sizeof(record.data));
+  return ~crc;
+}
+
+static bool autosave_page_valid(uint32_t page)
+{
+  const s_autosave_record *record = autosave_page(page);
+  return record->magic == autosave_magic && record->sequence != 0xffffffff && record->crc == autosave_crc(*record);
+}
+
+static bool autosave_range_erased(uint32_t first_page, uint32_t num_pages)
+{
+  const uint32_t *words = &autosave_memory[0][0] + first_page*autosave_page_words;
+  for(uint32_t idx = 0; idx < num_pages*autosave_page_words; idx++)
+  {
+    if(words[idx] != 0xffffffff) return false;
+  }
+  return true;
+}
+
+//check every page for the valid record with the highest sequence number,
+//returns -1 if there are none
+static int32_t autosave_scan_latest()
+{
+  int32_t latest_page = -1;
+  for(uint32_t page = 0; page < autosave_num_pages; page++)
+  {
+    if(autosave_page_valid(page) && (latest_page < 0 || autosave_page(page)->sequence > autosave_page(latest_page)->sequence))
+    {
+      latest_page = page;
+    }
+  }
+  return latest_page;
+}
+
+//returns the page holding the latest record, or -1 if there are none
+static int32_t autosave_find_latest()
+{
+  //sector 0 may have been erased ahead of a write to the last sector, then
+  //the oldest records start in sector 1
+  uint32_t base = 0;
+  if(!autosave_page_valid(base)) base = autosave_pages_per_sector;
+  if(!autosave_page_valid(base)) return autosave_scan_latest();
+
+  //Within a pass through the journal, the sequence number of each record is
+  //a fixed distance from its page number. Records from the previous pass are
+  //a whole pass behind.
+  const int64_t base_distance = (int64_t)autosave_page(base)->sequence - base;
+
+  //every sector in use starts with a valid record, binary search for the
+  //last sector written in this pass
+  uint32_t low = base/autosave_pages_per_sector;
+  uint32_t high = autosave_num_sectors - 1;
+  while(low < high)
+  {
+    const uint32_t mid = (low + high + 1)/2;
+    const uint32_t page = mid*autosave_pages_per_sector;
+    const bool valid = autosave_page_valid(page);
+
+    //a sector should start with a valid record or be erased
+    if(!valid && !autosave_range_erased(page, 1)) return autosave_scan_latest();
+
+    if(valid && (int64_t)autosave_page(page)->sequence - page >= base_distance)
+    {
+      low = mid;
+    }
+    else
+    {
+      high = mid - 1;
+    }
+  }
+
+  //then search that sector for the last record, skipping interrupted writes
+  const uint32_t first_page = low*autosave_pages_per_sector;
+  uint32_t latest_page = first_page;
+  for(uint32_t page = first_page + autosave_pages_per_sector - 1; page > first_page; page--)
+  {
+    if(autosave_page_valid(page) && (int64_t)autosave_page(page)->sequence - page >= base_distance)
+    {
+      latest_page = page;
+      break;
+    }
+  }
+
+  //the record must be valid and the next page must not hold a later record
+  const uint32_t next_page = (latest_page + 1) % autosave_num_pages;
+  if(!autosave_page_valid(latest_page) ||
+     (autosave_page_valid(next_page) && autosave_page(next_page)->sequence > autosave_page(latest_page)->sequence))
+  {
+    return autosave_scan_latest();
+  }
+  return latest_page;
+}
+
+//erase a sector and/or program a page, with the receiver suspended
+static void autosave_flash_operation(uint32_t erase_page, const s_autosave_record *record, uint32_t program_page, s_settings &settings, rx & receiver, rx_settings & rx_settings)
+{
+  const uint32_t base_address = (uint32_t)&(autosave_memory[0]) - XIP_BASE;
+
+  //!!! PICO is **very** fussy about flash erasing, there must be no code running in flash.  !!!
+  //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+  const uint32_t ints = flash_write_start(settings, receiver, rx_settings);
+
+  //safe to erase flash here
+  //--------------------------------------------------------------------------------------------
+  if(erase_page != 0xffffffff) flash_range_erase(base_address + erase_page*FLASH_PAGE_SIZE, FLASH_SECTOR_SIZE);
+  if(record) flash_range_program(base_address + program_page*FLASH_PAGE_SIZE, (const uint8_t*)record, FLASH_PAGE_SIZE);
+  //--------------------------------------------------------------------------------------------
+
+  flash_write_end(ints, settings, receiver, rx_settings);
+  //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+  //!!! Normal operation resumed
+}
+
+//range of each setting added since the original format, settings saved before
+//it was added are padded with 0xff. Each is one byte, settings in the same
+//group go back to their defaults together.
+struct s_setting_range
+{
+  uint16_t offset; //in s_global_settings
+  bool is_signed;
+  int16_t min;
+  int16_t max;
+  uint8_t group;
+};
+
+static const s_setting_range setting_ranges[] = {
+  {offsetof(s_global_settings, filter_width),     false, 0,             max_filter_width,         0},
+  {offsetof(s_global_settings, if_shift),         true,  -max_if_shift, max_if_shift,             0},
+  {offsetof(s_global_settings, squelch_type),     false, 0,             squelch_snr,              1},
+  {offsetof(s_global_settings, fm_discriminator), false, 0,             fm_discriminator_product, 2},
+  {offsetof(s_global_settings, tone_controls),    false, 0,             1,                        3},
+};
+static_assert(sizeof(s_global_settings::filter_width) == 1 && sizeof(s_global_settings::if_shift) == 1 &&
+  sizeof(s_global_settings::squelch_type) == 1 && sizeof(s_global_settings::fm_discriminator) == 1 &&
+  sizeof(s_global_settings::tone_controls) == 1);
+
+static void validate_settings(s_settings &settings)
+{
+  uint8_t *global = (uint8_t*)&settings.global;
+  const uint8_t *defaults = (const uint8_t*)&default_settings.global;
+
+  uint32_t invalid_groups = 0;
+  for(const s_setting_range &range : setting_ranges)
+  {
+    const int16_t value = range.is_signed ? (int8_t)global[range.offset] : global[range.offset];
+    if(value < range.min || value > range.max) invalid_groups |= 1u << range.group;
+  }
+
+  for(const s_setting_range &range : setting_ranges)
+  {
+    if(invalid_groups & (1u << range.group)) global[range.offset] = defaults[range.offset];
+  }
+}
+
 void autosave_restore_settings(s_settings &settings)
 {
+  const int32_t latest_page = autosave_find_latest();
+  if(latest_page >= 0)
+  {
+    memcpy(&settings, autosave_page(latest_page)->data, sizeof(s_settings));
+    validate_settings(settings);
+    return;
+  }
 
   //make sure that the memory channels are large enough to store the struct
   static_assert(sizeof(s_settings) < autosave_chan_size*4);
 
+  //fall back to settings saved in the original format, one per 128 bytes
   uint16_t latest_channel = 0xffff;
   for(uint16_t i=0; i<512; i++)
   {
@@ -129,106 +375,65 @@ void autosave_restore_settings(s_settings &settings)
   else
   {
     memcpy(&settings, autosave_memory[latest_channel], sizeof(s_settings));
+    validate_settings(settings);
   }
 
 }
 
 void autosave_store_settings(s_settings settings, rx & receiver, rx_settings & rx_settings)
 {
+  //the next record goes in the page after the latest
+  const int32_t latest_page = autosave_find_latest();
+  uint32_t page = latest_page < 0 ? 0 : (latest_page + 1) % autosave_num_pages;
 
-  //make sure that the memory channels are large enough to store the struct
-  static_assert(sizeof(s_settings) < autosave_chan_size*4);
-
-  //copy settings to an array
-  uint32_t data_to_save[autosave_chan_size] = {0xffffffff};
-  memcpy(data_to_save, &settings, sizeof(s_settings));
-
-  //The flash endurance may not be more than 100000 erase cycles.
-  //Cycle through 512 locations, only erasing the flash when they have all been used.
-  //This should give an endurance of 51,200,000 cycles.
-
-  //find the next unused channel, an unused channel will be 0xffffffff
-  uint16_t empty_channel = 0;
-  bool empty_channel_found = false;
-  for(uint16_t i=0; i<512; i++)
+  //Normally the page has been erased in advance. Skip over pages left by an
+  //interrupted write. A sector that isn't ready (or holds settings saved in
+  //the original format) is erased now.
+  uint32_t erase_page = 0xffffffff;
+  while(!autosave_range_erased(page, 1))
   {
-    volatile uint32_t * check_address = (uint32_t*)&autosave_memory[i][0];
-    if(*check_address == 0xffffffff)
+    if(page % autosave_pages_per_sector == 0)
     {
-      empty_channel = i;
-      empty_channel_found = true;
+      erase_page = page;
       break;
-    } 
-  }
-
-  //if there are no free channels, erase all the pages
-  if(!empty_channel_found)
-  {
-    const uint32_t address = (uint32_t)&(autosave_memory[0]);
-    const uint32_t flash_address = address - XIP_BASE; 
-    //!!! PICO is **very** fussy about flash erasing, there must be no code running in flash.  !!!
-    //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-    apply_settings_to_rx(receiver, rx_settings, settings, true, false); //suspend rx to disable all DMA transfers
-    sleep_us(10000);                                    //wait for suspension to take effect
-    multicore_lockout_start_blocking();                  //halt the second core
-    const uint32_t ints = save_and_disable_interrupts(); //disable all interrupts
-
-    //safe to erase flash here
-    //--------------------------------------------------------------------------------------------
-    flash_range_erase(flash_address, sizeof(int)*autosave_chan_size*512);
-    //--------------------------------------------------------------------------------------------
-
-    restore_interrupts (ints);                           //restore interrupts
-    multicore_lockout_end_blocking();                    //restart the second core
-    apply_settings_to_rx(receiver, rx_settings, settings, false, false); //resume rx operation
-    //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-    //!!! Normal operation resumed
-  }
-
-  //work out which flash sector the channel sits in.
-  const uint32_t num_channels_per_sector = FLASH_SECTOR_SIZE/(sizeof(int)*autosave_chan_size);
-  const uint32_t first_channel_in_sector = num_channels_per_sector * (empty_channel/num_channels_per_sector);
-  const uint32_t channel_offset_in_sector = empty_channel%num_channels_per_sector;
-
-  //copy sector to RAM
-  static uint32_t sector_copy[num_channels_per_sector][autosave_chan_size];
-  for(uint16_t channel=0; channel<num_channels_per_sector; channel++)
-  {
-    for(uint16_t location=0; location<autosave_chan_size; location++)
-    {
-      if(channel+first_channel_in_sector < num_chans)
-      {
-        sector_copy[channel][location] = autosave_memory[channel+first_channel_in_sector][location];
-      }
     }
+    page = (page + 1) % autosave_num_pages;
   }
-    
-  //modify the selected channel
-  for(uint8_t i=0; i<autosave_chan_size; i++)
+
+  //keep the distance between sequence number and page for skipped pages
+  uint32_t sequence = page;
+  if(latest_page >= 0)
   {
-    sector_copy[channel_offset_in_sector][i] = data_to_save[i];
+    sequence = autosave_page(latest_page)->sequence + (page + autosave_num_pages - latest_page) % autosave_num_pages;
   }
 
-  //write sector to flash
-  const uint32_t address = (uint32_t)&(autosave_memory[first_channel_in_sector]);
-  const uint32_t flash_address = address - XIP_BASE; 
+  static s_autosave_record record;
+  memset(&record, 0xff, sizeof(record));
+  record.magic = autosave_magic;
+  record.sequence = sequence;
+  memcpy(record.data, &settings, sizeof(s_settings));
+  record.crc = autosave_crc(record);
 
-  //!!! PICO is **very** fussy about flash erasing, there must be no code running in flash.  !!!
-  //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  apply_settings_to_rx(receiver, rx_settings, settings, true, false); //suspend rx to disable all DMA transfers
-  sleep_us(10000);                                    //wait for suspension to take effect
-  multicore_lockout_start_blocking();                  //halt the second core
-  const uint32_t ints = save_and_disable_interrupts(); //disable all interrupts
+  autosave_flash_operation(erase_page, &record, page, settings, receiver, rx_settings);
+  autosave_erase_pending = true;
+}
 
-  //safe to erase flash here
-  //--------------------------------------------------------------------------------------------
-  flash_range_program(flash_address, (const uint8_t*)&sector_copy, FLASH_SECTOR_SIZE);
-  //--------------------------------------------------------------------------------------------
+void autosave_erase_ahead(s_settings &settings, rx & receiver, rx_settings & rx_settings)
+{
+  if(!autosave_erase_pending) return;
+  autosave_erase_pending = false;
 
-  restore_interrupts (ints);                           //restore interrupts
-  multicore_lockout_end_blocking();                    //restart the second core
-  apply_settings_to_rx(receiver, rx_settings, settings, false, false);  //resume rx operation
-  //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  //!!! Normal operation resumed
+  //nothing to do until the first record is saved, settings in the original
+  //format are left alone until then
+  const int32_t latest_page = autosave_find_latest();
+  if(latest_page < 0) return;
 
+  //make sure the sector after the one being written is ready for use
+  const uint32_t sector = latest_page / autosave_pages_per_sector;
+  const uint32_t next_sector = (sector + 1) % autosave_num_sectors;
+  const uint32_t first_page = next_sector * autosave_pages_per_sector;
+  if(!autosave_range_erased(first_page, autosave_pages_per_sector))
+  {
+    autosave_flash_operation(first_page, NULL, 0, settings, receiver, rx_settings);
+  }
 }
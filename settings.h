@@ -10,6 +10,9 @@ const uint8_t  autosave_chan_size = 32;
 const uint8_t  memory_chan_size = 16;
 const uint16_t num_chans = 512;
 
+const uint8_t  max_filter_width = 200; //10kHz
+const int8_t   max_if_shift = 40;      //2kHz
+
 enum e_mode
 {
   MODE_AM = 0,
@@ -91,6 +94,11 @@ struct s_global_settings
   bool    enable_test_tone;
   bool    tx_modulation;
   bool    enable_external_nco;
+  uint8_t filter_width; //x50Hz, 0 uses the bandwidth preset
+  int8_t  if_shift;     //x50Hz
+  uint8_t squelch_type; //signal strength, SNR
+  uint8_t fm_discriminator; //phase, product
+  uint8_t tone_controls; //per sample, FFT
 };
 
 struct s_settings
@@ -162,6 +170,11 @@ const s_settings default_settings = {
   0,  //enable_test_tone
   0,  //tx_modulation
   0,  //enable_external_nco
+  0,  //filter_width = preset
+  0,  //if_shift
+  0,  //squelch_type = signal strength
+  0,  //fm_discriminator = phase
+  1,  //tone_controls = FFT
 }};
 
 
@@ -175,6 +188,7 @@ struct s_memory_channel
 void apply_settings_to_rx(rx & receiver, rx_settings & rx_settings, s_settings & settings, bool suspend, bool settings_changed);
 void autosave_restore_settings(s_settings &settings);
 void autosave_store_settings(s_settings settings, rx & receiver, rx_settings & rx_settings);
+void autosave_erase_ahead(s_settings &settings, rx & receiver, rx_settings & rx_settings);
 s_memory_channel get_channel(uint16_t channel_number);
 void memory_store_channel(s_memory_channel memory_channel, uint16_t channel_number, s_settings & settings, rx & receiver, rx_settings & rx_settings);
 
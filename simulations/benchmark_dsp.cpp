@@ -0,0 +1,169 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: benchmark_dsp.cpp
+// description: feed synthetic ADC blocks through rx_dsp and time each stage
+// License: MIT
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+#include "../rx_dsp.h"
+#include "../rx_definitions.h"
+
+static const char mode_names[6][7] = {"AM", "AMSYNC", "LSB", "USB", "FM", "CW"};
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+//Interleaved I/Q ADC samples as they arrive from the DMA, an AM modulated
+//carrier and a second unmodulated carrier on top of a little noise.
+static void make_adc_block(uint16_t samples[], uint32_t &t, uint32_t &seed)
+{
+  const double carrier_Hz = 10e3;
+  const double interferer_Hz = -3e3;
+  const double modulation_Hz = 400.0;
+  const double iq_sample_rate = adc_sample_rate/2.0;
+
+  for(uint16_t idx=0; idx<adc_block_size; idx+=2)
+  {
+    const double time = (double)t++/iq_sample_rate;
+    const double envelope = 1.0 + 0.5*sin(2.0*M_PI*modulation_Hz*time);
+    const double i = 400.0*envelope*cos(2.0*M_PI*carrier_Hz*time) + 50.0*cos(2.0*M_PI*interferer_Hz*time);
+    const double q = 400.0*envelope*sin(2.0*M_PI*carrier_Hz*time) + 50.0*sin(2.0*M_PI*interferer_Hz*time);
+    seed = seed * 1664525u + 1013904223u;
+    const int16_t noise_i = (seed >> 24) & 0x1f;
+    seed = seed * 1664525u + 1013904223u;
+    const int16_t noise_q = (seed >> 24) & 0x1f;
+    samples[idx] = 2048 + (int16_t)i + noise_i;
+    samples[idx + 1] = 2048 + (int16_t)q + noise_q;
+  }
+}
+
+//Time the FFT filter alone at one size, passing a USB (300 Hz to 2.7 kHz)
+//filter. The ADC block, and the time it covers, grows with the FFT size, so
+//the load is compared as a percentage of real time. RAM counts the filter
+//state, the spectrum capture and the ADC ping/pong buffers, which all scale
+//with the FFT size.
+template<uint8_t order>
+static void benchmark_fft_filter(uint32_t num_blocks)
+{
+  const uint16_t size = 1u << order;
+  const double iq_sample_rate = (double)adc_sample_rate/cic_decimation_rate;
+  const double bin_Hz = iq_sample_rate/size;
+  const double block_time_ns = 1e9*(size/2)/iq_sample_rate;
+
+  fft_filter<order> *filter = new fft_filter<order>();
+  s_filter_control control = {};
+  control.low_edge_Hz = 300;
+  control.high_edge_Hz = 2700;
+  filter->set_mask(control);
+
+  //pre-generate the input, a tone at 1 kHz with a little noise
+  const uint16_t num_precomputed = 16;
+  static int16_t input[num_precomputed][2 << fft_max_order];
+  static int16_t capture[1 << fft_max_order];
+  uint32_t seed = 1;
+  for(uint32_t t = 0; t < num_precomputed*size/2; ++t)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    int16_t *sample = &input[t/(size/2)][2*(t%(size/2))];
+    sample[0] = 4000.0*cos(2.0*M_PI*1000.0*t/iq_sample_rate) + (int16_t)(seed >> 24);
+    sample[1] = 4000.0*sin(2.0*M_PI*1000.0*t/iq_sample_rate) + (int16_t)(seed >> 16 & 0xff);
+  }
+
+  int16_t iq[size];
+  const uint64_t start = now_ns();
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    memcpy(iq, input[block % num_precomputed], sizeof(iq));
+    control.capture = block & 1;
+    filter->process_sample(iq, control, capture);
+  }
+  const double ns_per_block = (double)(now_ns() - start)/num_blocks;
+
+  const unsigned ram = sizeof(fft_filter<order>) + size*sizeof(int16_t) + 2*(size/2)*cic_decimation_rate*sizeof(uint16_t);
+  printf("%-7u %10.1f %10.2f %10.0f %7.2f%% %10u\n", size, bin_Hz, block_time_ns/1e6, ns_per_block, 100.0*ns_per_block/block_time_ns, ram);
+
+  delete filter;
+}
+
+int main(int argc, char *argv[])
+{
+  const uint32_t num_blocks = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000;
+  const uint32_t warmup_blocks = 16;
+  const uint32_t num_precomputed = 64;
+  const double block_time_ns = 1e9*adc_block_size/adc_sample_rate;
+
+  //pre-generate the input so that only the DSP is timed
+  static uint16_t adc_blocks[num_precomputed][adc_block_size];
+  uint32_t t = 0, seed = 1;
+  for(uint16_t block = 0; block < num_precomputed; ++block)
+  {
+    make_adc_block(adc_blocks[block], t, seed);
+  }
+
+  printf("%u blocks of %u ADC samples, real-time budget %.0f ns/block\n\n", num_blocks, adc_block_size, block_time_ns);
+  printf("%-7s %10s %7s %8s", "mode", "ns/block", "budget", "demod ns");
+  for(uint8_t stage = 0; stage < dsp_num_stages; ++stage) printf(" %11s", dsp_stage_names[stage]);
+  printf("\n");
+
+  for(uint8_t mode = AM; mode <= CW; ++mode)
+  {
+    rx_dsp *dsp = new rx_dsp();
+    dsp->set_gain_cal_dB(62);
+    dsp->set_squelch(0, 0);
+    dsp->set_agc_control(3, 10);
+    dsp->set_mode(mode, 2);
+    dsp->set_frequency_offset_Hz(10e3);
+
+    int16_t audio[adc_block_size/decimation_rate];
+    for(uint32_t block = 0; block < warmup_blocks; ++block)
+    {
+      dsp->process_block(adc_blocks[block % num_precomputed], audio, NULL);
+    }
+    dsp->profile.reset();
+
+    const uint64_t start = now_ns();
+    for(uint32_t block = 0; block < num_blocks; ++block)
+    {
+      dsp->process_block(adc_blocks[block % num_precomputed], audio, NULL);
+    }
+    const double ns_per_block = (double)(now_ns() - start)/num_blocks;
+
+    uint64_t profiled_total = 0;
+    for(uint8_t stage = 0; stage < dsp_num_stages; ++stage) profiled_total += dsp->profile.total[stage];
+
+    printf("%-7s %10.0f %6.2f%% %8.0f", mode_names[mode], ns_per_block, 100.0*ns_per_block/block_time_ns,
+      (double)dsp->profile.total[dsp_stage_demodulate]/num_blocks);
+    for(uint8_t stage = 0; stage < dsp_num_stages; ++stage)
+    {
+      printf(" %10.1f%%", profiled_total ? 100.0*dsp->profile.total[stage]/profiled_total : 0.0);
+    }
+    printf("\n");
+
+    delete dsp;
+  }
+
+  printf("\nfft filter, built for %u points\n", fft_size);
+  printf("%-7s %10s %10s %10s %8s %10s\n", "points", "bin Hz", "block ms", "ns/block", "budget", "RAM bytes");
+  benchmark_fft_filter<7>(num_blocks*2);
+  benchmark_fft_filter<8>(num_blocks);
+  benchmark_fft_filter<9>(num_blocks/2 + 1);
+  benchmark_fft_filter<10>(num_blocks/4 + 1);
+
+  return 0;
+}
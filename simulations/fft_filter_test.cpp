@@ -5,32 +5,31 @@
 int main()
 {
 
-  fft_filter filt;
+  fft_filter<fft_order> filt;
+  int16_t capture[fft_size] = {0};
 
   for(uint8_t j=0; j<4; ++j)
   {
-    int16_t i[128] = {0};
-    int16_t q[128] = {0};
+    int16_t iq[fft_size] = {0};
     uint32_t t = 0;
-    for(uint16_t idx = 0; idx<128; ++idx)
+    for(uint16_t idx = 0; idx<fft_size/2; ++idx)
     {
-      i[idx] = cos(8*2.0*M_PI*t/128.0)*2048*2;// + cos(10*2.0*M_PI*t/128.0)*2048;
-      q[idx] = 0; //sin(10*2.0*M_PI*t/2048.0) * 500;
+      iq[2*idx] = cos(8*2.0*M_PI*t/128.0)*2048*2;// + cos(10*2.0*M_PI*t/128.0)*2048;
+      iq[2*idx+1] = 0; //sin(10*2.0*M_PI*t/2048.0) * 500;
       t++;
     }
 
-    s_filter_control fc;
-    fc.start_bin = 0;
-    fc.stop_bin = 32;
-    fc.upper_sideband = true;
-    fc.lower_sideband = false;
+    s_filter_control fc = {};
+    fc.low_edge_Hz = 0;
+    fc.high_edge_Hz = 3750;
     fc.capture = false;
+    if(j == 0) filt.set_mask(fc);
 
-    filt.process_sample(i, q, fc, NULL);
+    filt.process_sample(iq, fc, capture);
 
-    for(uint16_t idx = 0; idx<64; ++idx)
+    for(uint16_t idx = 0; idx<fft_size/4; ++idx)
     {
-      printf("%u %i %i\n", idx, i[idx], q[idx]);
+      printf("%u %i %i\n", idx, iq[2*idx], iq[2*idx+1]);
     }
   }
 
@@ -37,3 +37,13 @@ print("static const uint32_t alpha_lut[] = {")
 for line in alpha_lines:
     print("    " + ", ".join(map(str, line)) + ",")
 print("};")
+
+#reciprocals of a 9 bit normalised denominator, rounded to the middle of
+#each interval of the 8 bit mantissa
+reciprocal = [round(2 ** 24 / (256 + i + 0.5)) for i in range(256)]
+reciprocal_lines = [reciprocal[i : i + 9] for i in range(0, len(reciprocal), 9)]
+print()
+print("static const uint16_t reciprocal_lut[] = {")
+for line in reciprocal_lines:
+    print("    " + ", ".join(map(str, line)) + ",")
+print("};")
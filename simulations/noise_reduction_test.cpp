@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include "../noise_reduction.h"
+#include "../utils.h"
 
 
 int main()
@@ -10,14 +11,7 @@ int main()
 
   int16_t i[128];
   int16_t q[128];
-  int32_t noise_estimate[128] = {0};
-  int16_t signal_estimate[128] = {0};
-
-  for(int idx=0; idx<128; ++idx)
-  {
-    noise_estimate[idx] = INT32_MAX-1;
-    signal_estimate[idx] = 0;
-  }
+  noise_floor<128> floors;
 
   uint16_t frame = 0;
   while(1)
@@ -33,13 +27,18 @@ int main()
 
     std::cerr << "input frame" << frame << std::endl;
 
-    noise_reduction(i, q, noise_estimate, signal_estimate, 0, 127, 8, 0);
+    for(int idx=0; idx<128; ++idx)
+    {
+      floors.update(idx, rectangular_2_magnitude(i[idx], q[idx]));
+    }
+    floors.end_block(2);
+    noise_reduction(i, q, floors.estimates(), 0, 127, 0);
 
     std::cerr << "output frame" << frame++ << std::endl;
 
     for(int idx=0; idx<128; ++idx)
     {
-      std::cout << i[idx] << " " << q[idx] << " " << noise_estimate[idx] << " " << 1024*signal_estimate[idx] << " ";
+      std::cout << i[idx] << " " << q[idx] << " " << floors[idx].noise << " " << 1024*floors[idx].signal << " ";
     }
     std::cout << std::endl;
 
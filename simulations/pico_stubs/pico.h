@@ -0,0 +1,31 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: pico.h
+// description: minimal stand-in for the pico-sdk, allows the DSP code to be
+//              compiled and benchmarked on a host PC
+// License: MIT
+//
+
+#ifndef PICO_STUB_H
+#define PICO_STUB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+//everything runs from RAM on a PC
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __not_in_flash(group)
+#define __in_flash(...)
+#define __force_inline inline __attribute__((always_inline))
+
+#endif
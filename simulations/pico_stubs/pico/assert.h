@@ -0,0 +1,8 @@
+#ifndef PICO_STUB_ASSERT_H
+#define PICO_STUB_ASSERT_H
+
+#include <assert.h>
+
+#define hard_assert(x) assert(x)
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef PICO_STUB_CRITICAL_SECTION_H
+#define PICO_STUB_CRITICAL_SECTION_H
+
+#include "pico.h"
+
+typedef volatile uint32_t spin_lock_t;
+
+typedef struct {
+  spin_lock_t *spin_lock;
+} critical_section_t;
+
+static inline void spin_lock_unsafe_blocking(spin_lock_t *lock) { (void)lock; }
+static inline void spin_unlock_unsafe(spin_lock_t *lock) { (void)lock; }
+
+static inline void critical_section_init(critical_section_t *crit) { crit->spin_lock = NULL; }
+static inline void critical_section_init_with_lock_num(critical_section_t *crit, uint lock_num) { (void)lock_num; crit->spin_lock = NULL; }
+static inline void critical_section_enter_blocking(critical_section_t *crit) { (void)crit; }
+static inline void critical_section_exit(critical_section_t *crit) { (void)crit; }
+
+#endif
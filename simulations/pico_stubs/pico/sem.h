@@ -0,0 +1,38 @@
+#ifndef PICO_STUB_SEM_H
+#define PICO_STUB_SEM_H
+
+#include "pico.h"
+
+//The host build is single threaded, so a semaphore is just a counter
+typedef struct {
+  int16_t permits;
+  int16_t max_permits;
+} semaphore_t;
+
+static inline void sem_init(semaphore_t *sem, int16_t initial_permits, int16_t max_permits)
+{
+  sem->permits = initial_permits;
+  sem->max_permits = max_permits;
+}
+
+static inline bool sem_try_acquire(semaphore_t *sem)
+{
+  if (sem->permits == 0) return false;
+  sem->permits--;
+  return true;
+}
+
+static inline void sem_acquire_blocking(semaphore_t *sem)
+{
+  //nothing else can release the semaphore, so it must already be available
+  while (!sem_try_acquire(sem));
+}
+
+static inline bool sem_release(semaphore_t *sem)
+{
+  if (sem->permits == sem->max_permits) return false;
+  sem->permits++;
+  return true;
+}
+
+#endif
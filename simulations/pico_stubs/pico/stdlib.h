@@ -0,0 +1,29 @@
+#ifndef PICO_STUB_STDLIB_H
+#define PICO_STUB_STDLIB_H
+
+#include <time.h>
+
+#include "pico.h"
+#include "pico/assert.h"
+#include "pico/sync.h"
+
+typedef uint64_t absolute_time_t;
+
+static inline uint64_t time_us_64(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000u;
+}
+
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+static inline absolute_time_t get_absolute_time(void) { return time_us_64(); }
+static inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000u); }
+
+static inline void sleep_us(uint64_t us)
+{
+  const uint64_t end = time_us_64() + us;
+  while (time_us_64() < end);
+}
+
+#endif
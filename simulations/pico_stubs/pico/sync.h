@@ -0,0 +1,10 @@
+#ifndef PICO_STUB_SYNC_H
+#define PICO_STUB_SYNC_H
+
+#include "pico/sem.h"
+#include "pico/critical_section.h"
+
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void)status; }
+
+#endif
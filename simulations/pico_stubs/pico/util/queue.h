@@ -0,0 +1,49 @@
+#ifndef PICO_STUB_QUEUE_H
+#define PICO_STUB_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico.h"
+
+typedef struct {
+  uint8_t *data;
+  uint16_t wptr;
+  uint16_t rptr;
+  uint16_t element_size;
+  uint16_t element_count;
+} queue_t;
+
+static inline void queue_init(queue_t *q, uint element_size, uint element_count)
+{
+  q->data = (uint8_t *)calloc(element_count + 1, element_size);
+  q->element_size = element_size;
+  q->element_count = element_count;
+  q->wptr = 0;
+  q->rptr = 0;
+}
+
+static inline uint queue_get_level(queue_t *q)
+{
+  int32_t level = q->wptr - q->rptr;
+  if (level < 0) level += q->element_count + 1;
+  return level;
+}
+
+static inline bool queue_try_add(queue_t *q, const void *data)
+{
+  if (queue_get_level(q) == q->element_count) return false;
+  memcpy(q->data + q->wptr * q->element_size, data, q->element_size);
+  if (++q->wptr > q->element_count) q->wptr = 0;
+  return true;
+}
+
+static inline bool queue_try_remove(queue_t *q, void *data)
+{
+  if (q->wptr == q->rptr) return false;
+  memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+  if (++q->rptr > q->element_count) q->rptr = 0;
+  return true;
+}
+
+#endif
@@ -0,0 +1,102 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_agc.cpp
+// description: check the attack, hang and decay of the block AGC
+// License: MIT
+//
+// A 1kHz tone is received in USB with each AGC setting. The tone steps up by
+// 30dB, and the output shouldn't overshoot the set point by more than the
+// soft clipping allows. The tone then steps down by 20dB, and the output
+// should recover to within 6dB of the set point after the hang time and
+// decay time of the setting, as they were for the per-sample AGC.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+#include <algorithm>
+
+#include "../rx_dsp.h"
+
+static const double iq_sample_rate = adc_sample_rate / 2.0;
+static const double offset_Hz = 10e3;
+static const uint16_t num_audio_samples = adc_block_size / decimation_rate;
+static const int16_t setpoint = INT16_MAX / 2;
+
+//peak output of each block
+static void receive(rx_dsp &dsp, double amplitude, uint32_t num_blocks, uint32_t &t, int16_t peaks[])
+{
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    uint16_t samples[adc_block_size];
+    for(uint16_t idx = 0; idx < adc_block_size; idx += 2, ++t)
+    {
+      const std::complex<double> iq = std::polar(amplitude, 2.0 * M_PI * (offset_Hz + 1000.0) * t / iq_sample_rate);
+      samples[idx] = 2048 + lround(iq.real());
+      samples[idx + 1] = 2048 + lround(iq.imag());
+    }
+    int16_t audio[num_audio_samples];
+    dsp.process_block(samples, audio, NULL);
+    int16_t peak = 0;
+    for(uint16_t idx = 0; idx < num_audio_samples; ++idx) peak = std::max(peak, (int16_t)abs(audio[idx]));
+    peaks[block] = peak;
+  }
+}
+
+int main()
+{
+  static const char setting_names[4][7] = {"fast", "medium", "slow", "long"};
+  const uint8_t decay_factors[] = {10, 11, 12, 14};
+  const uint16_t hang_times[] = {1500, 3750, 15000, 30000};
+  const double block_s = (double)num_audio_samples / audio_sample_rate;
+  bool pass = true;
+
+  printf("%-8s %10s %10s %12s %12s\n", "setting", "steady", "overshoot", "recovery s", "expected s");
+  for(uint8_t setting = 0; setting < 4; ++setting)
+  {
+    rx_dsp *dsp = new rx_dsp();
+    dsp->set_gain_cal_dB(62);
+    dsp->set_squelch(0, 0);
+    dsp->set_agc_control(setting, 10);
+    dsp->set_mode(USB, 2);
+    dsp->set_frequency_offset_Hz(offset_Hz);
+
+    //settle on a quiet tone, then step up 30dB
+    const uint32_t settle_blocks = 6.0 / block_s;
+    const uint32_t loud_blocks = 0.5 / block_s;
+    const uint32_t recover_blocks = 5.0 / block_s;
+    int16_t *peaks = new int16_t[settle_blocks + loud_blocks + recover_blocks];
+    uint32_t t = 0;
+    receive(*dsp, 60.0, settle_blocks, t, peaks);
+    const int16_t steady = *std::max_element(&peaks[settle_blocks - 50], &peaks[settle_blocks]);
+    receive(*dsp, 60.0 * 31.62, loud_blocks, t, &peaks[settle_blocks]);
+    const int16_t overshoot = *std::max_element(&peaks[settle_blocks], &peaks[settle_blocks + loud_blocks]);
+
+    //step down 20dB, time until within 6dB of the set point
+    receive(*dsp, 60.0 * 3.162, recover_blocks, t, &peaks[settle_blocks + loud_blocks]);
+    const int16_t *quiet_peaks = &peaks[settle_blocks + loud_blocks];
+    uint32_t recovery_blocks = 0;
+    while(recovery_blocks < recover_blocks && quiet_peaks[recovery_blocks] >= setpoint / 2) recovery_blocks++;
+    while(recovery_blocks < recover_blocks && quiet_peaks[recovery_blocks] < setpoint / 2) recovery_blocks++;
+    const double recovery_s = recovery_blocks * block_s;
+
+    //hang, then decay by a factor of 5 at (1-2^-decay_factor) per sample
+    const double expected_s = (hang_times[setting] + log(5.0) * (1 << decay_factors[setting])) / audio_sample_rate;
+
+    const bool ok = fabs(20.0 * log10((double)steady / setpoint)) < 1.5 && overshoot < setpoint * 1.25 &&
+      fabs(recovery_s / expected_s - 1.0) < 0.15;
+    printf("%-8s %10d %10d %12.3f %12.3f %s\n", setting_names[setting], steady, overshoot, recovery_s, expected_s, ok ? "PASS" : "FAIL");
+    pass &= ok;
+    delete[] peaks;
+    delete dsp;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
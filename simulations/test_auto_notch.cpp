@@ -0,0 +1,106 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_auto_notch.cpp
+// description: check that the auto notch removes several steady carriers
+// License: MIT
+//
+// Two filters, one with the auto notch, are fed three steady carriers and a
+// tone that hops between two frequencies every 30 blocks, like a slow FSK
+// signal, in a little noise. After 2 seconds each carrier should be well
+// down in the output of the notch filter, while the hopping tone should be
+// untouched.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+
+#include "../fft_filter.h"
+
+static const double iq_sample_rate = (double)adc_sample_rate/cic_decimation_rate;
+static const double output_sample_rate = iq_sample_rate/2.0;
+
+int main()
+{
+  const double carrier_Hz[] = {1000.0, 2300.0, -1700.0};
+  const double hop_Hz[] = {600.0, 3100.0};
+  const uint16_t hop_blocks = 30;
+  const uint32_t num_blocks = 480; //ends 30 blocks into a hop
+  const uint32_t measure_blocks = 20;
+
+  fft_filter<fft_order> *notch_filter = new fft_filter<fft_order>();
+  fft_filter<fft_order> *plain_filter = new fft_filter<fft_order>();
+  static int16_t capture[fft_size];
+
+  s_filter_control control = {};
+  control.low_edge_Hz = -4000;
+  control.high_edge_Hz = 4000;
+  notch_filter->set_mask(control);
+  plain_filter->set_mask(control);
+
+  const uint8_t num_tones = 4;
+  std::complex<double> notch_level[num_tones], plain_level[num_tones];
+  uint32_t seed = 1, t = 0, output_t = 0;
+  double hop_phase = 0.0;
+
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    const double hop_frequency_Hz = hop_Hz[(block / hop_blocks) % 2];
+    int16_t notch_iq[fft_size], plain_iq[fft_size];
+    for(uint16_t idx = 0; idx < fft_size/2; ++idx, ++t)
+    {
+      std::complex<double> sample = 1000.0 * std::polar(1.0, 2.0 * M_PI * hop_phase);
+      hop_phase += hop_frequency_Hz / iq_sample_rate;
+      for(double frequency_Hz : carrier_Hz)
+      {
+        sample += 1000.0 * std::polar(1.0, 2.0 * M_PI * frequency_Hz * t / iq_sample_rate);
+      }
+      seed = seed * 1664525u + 1013904223u;
+      notch_iq[2*idx] = plain_iq[2*idx] = sample.real() + (int8_t)(seed >> 24) / 4;
+      notch_iq[2*idx+1] = plain_iq[2*idx+1] = sample.imag() + (int8_t)(seed >> 16) / 4;
+    }
+
+    control.enable_auto_notch = true;
+    notch_filter->process_sample(notch_iq, control, capture);
+    control.enable_auto_notch = false;
+    plain_filter->process_sample(plain_iq, control, capture);
+
+    //measure each tone in the output of the last few blocks
+    for(uint16_t idx = 0; idx < fft_size/4; ++idx, ++output_t)
+    {
+      if(block < num_blocks - measure_blocks) continue;
+      const std::complex<double> notch_sample(notch_iq[2*idx], notch_iq[2*idx+1]);
+      const std::complex<double> plain_sample(plain_iq[2*idx], plain_iq[2*idx+1]);
+      for(uint8_t tone = 0; tone < num_tones; ++tone)
+      {
+        const double frequency_Hz = tone < 3 ? carrier_Hz[tone] : hop_frequency_Hz;
+        const std::complex<double> reference = std::polar(1.0, -2.0 * M_PI * frequency_Hz * output_t / output_sample_rate);
+        notch_level[tone] += notch_sample * reference;
+        plain_level[tone] += plain_sample * reference;
+      }
+    }
+  }
+
+  bool pass = true;
+  printf("%-10s %10s %12s\n", "tone", "Hz", "change dB");
+  for(uint8_t tone = 0; tone < num_tones; ++tone)
+  {
+    const double change_dB = 20.0 * log10(std::abs(notch_level[tone]) / std::abs(plain_level[tone]));
+    const bool carrier = tone < 3;
+    const bool ok = carrier ? change_dB < -20.0 : change_dB > -1.0;
+    printf("%-10s %10.0f %12.1f %s\n", carrier ? "carrier" : "hopping", carrier ? carrier_Hz[tone] : hop_Hz[1], change_dB, ok ? "PASS" : "FAIL");
+    pass &= ok;
+  }
+
+  delete notch_filter;
+  delete plain_filter;
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
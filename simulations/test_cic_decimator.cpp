@@ -0,0 +1,108 @@
+#include "../cic_decimator.h"
+#include <cstdio>
+#include <cstdint>
+
+//Sample by sample reference, the decimator used before cic_decimator
+struct reference_decimator
+{
+  uint8_t decimate_count = 0;
+  int32_t integratori1 = 0, integratorq1 = 0;
+  int32_t integratori2 = 0, integratorq2 = 0;
+  int32_t integratori3 = 0, integratorq3 = 0;
+  int32_t integratori4 = 0, integratorq4 = 0;
+  int32_t delayi0 = 0, delayq0 = 0;
+  int32_t delayi1 = 0, delayq1 = 0;
+  int32_t delayi2 = 0, delayq2 = 0;
+  int32_t delayi3 = 0, delayq3 = 0;
+
+  bool decimate(int16_t &i, int16_t &q)
+  {
+    integratori1 += i;
+    integratorq1 += q;
+    integratori2 += integratori1;
+    integratorq2 += integratorq1;
+    integratori3 += integratori2;
+    integratorq3 += integratorq2;
+    integratori4 += integratori3;
+    integratorq4 += integratorq3;
+
+    decimate_count++;
+    if(decimate_count >= cic_decimation_rate)
+    {
+      decimate_count = 0;
+      const int32_t combi1 = integratori4-delayi0;
+      const int32_t combq1 = integratorq4-delayq0;
+      const int32_t combi2 = combi1-delayi1;
+      const int32_t combq2 = combq1-delayq1;
+      const int32_t combi3 = combi2-delayi2;
+      const int32_t combq3 = combq2-delayq2;
+      const int32_t combi4 = combi3-delayi3;
+      const int32_t combq4 = combq3-delayq3;
+      delayi0 = integratori4;
+      delayq0 = integratorq4;
+      delayi1 = combi1;
+      delayq1 = combq1;
+      delayi2 = combi2;
+      delayq2 = combq2;
+      delayi3 = combi3;
+      delayq3 = combq3;
+      i = combi4>>(cic_bit_growth-extra_bits);
+      q = combq4>>(cic_bit_growth-extra_bits);
+      return true;
+    }
+    return false;
+  }
+};
+
+int main()
+{
+  uint32_t errors = 0;
+  for(uint8_t swap_iq = 0; swap_iq < 2; ++swap_iq)
+  {
+    reference_decimator reference;
+    cic_decimator cic_i, cic_q;
+    uint32_t seed = 12345;
+
+    //enough blocks for the integrators to wrap many times
+    for(uint32_t block = 0; block < 20000; ++block)
+    {
+      uint16_t samples[adc_block_size];
+      for(uint16_t idx = 0; idx < adc_block_size; ++idx)
+      {
+        seed = seed * 1664525u + 1013904223u;
+        samples[idx] = (block & 1) ? seed >> 20 : 2048 + ((seed >> 24) & 0x3f);
+      }
+
+      int16_t expected[2 * adc_block_size / cic_decimation_rate];
+      uint16_t decimated_index = 0;
+      for(uint16_t idx = 0; idx < adc_block_size; ++idx)
+      {
+        const int16_t raw_sample = samples[idx];
+        int16_t i = ((idx&1)^1^swap_iq)*raw_sample;
+        int16_t q = ((idx&1)^swap_iq)*raw_sample;
+        if(reference.decimate(i, q))
+        {
+          expected[decimated_index] = i;
+          expected[decimated_index + 1] = q;
+          decimated_index += 2;
+        }
+      }
+
+      int16_t actual[2 * adc_block_size / cic_decimation_rate];
+      cic_i.process_block(samples, swap_iq, &actual[0]);
+      cic_q.process_block(samples, !swap_iq, &actual[1]);
+
+      for(uint16_t idx = 0; idx < 2 * adc_block_size / cic_decimation_rate; ++idx)
+      {
+        if(actual[idx] != expected[idx])
+        {
+          if(errors < 10) printf("swap_iq=%u block %u sample %u: expected %i got %i\n", swap_iq, block, idx, expected[idx], actual[idx]);
+          errors++;
+        }
+      }
+    }
+  }
+
+  printf("%s: %u mismatches\n", errors ? "FAIL" : "PASS", errors);
+  return errors ? 1 : 0;
+}
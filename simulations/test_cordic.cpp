@@ -0,0 +1,185 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_cordic.cpp
+// description: error and time of the cordic at each precision
+// License: MIT
+//
+// Random IQ pairs are converted to polar with each number of iterations,
+// and compared with atan2 and hypot. The phase error should roughly halve
+// with each iteration, down to the resolution of the angle table. The time
+// per sample for the block API is shown with both outputs, and with the
+// phase only, as a guide to the cheapest precision that meets a need. The
+// 6 iteration cordic with an int16_t state should match the one that was in
+// utils.cpp exactly.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+#include "../cordic.h"
+
+static const uint32_t num_samples = 64;
+static const uint32_t num_blocks = 4000;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+//the 6 iteration cordic from utils.cpp
+static void reference_rectangular_2_polar(int16_t i, int16_t q, uint16_t *mag, int16_t *phase)
+{
+  static const int16_t atan_lut[6] = {8192, 4836, 2555, 1297, 651, 326};
+  int16_t temp_i;
+  int16_t angle = 0;
+  if (i < 0) {
+    temp_i = i;
+    if (q > 0.0f) {
+      i = q;
+      q = -temp_i;
+      angle = 16384;
+    } else {
+      i = -q;
+      q = temp_i;
+      angle = -16384;
+    }
+  }
+  for (uint16_t k = 0; k < 6; k++) {
+    temp_i = i;
+    if (q > 0) {
+      i += (q >> k);
+      q -= (temp_i >> k);
+      angle += atan_lut[k];
+    } else {
+      i -= (q >> k);
+      q += (temp_i >> k);
+      angle -= atan_lut[k];
+    }
+  }
+  *mag = ((uint32_t)i * 39803) >> 16;
+  *phase = angle;
+}
+
+//random IQ pairs, with magnitudes that an int16_t state can rotate
+static void make_block(int16_t iq[], uint32_t &seed)
+{
+  for(uint32_t idx = 0; idx < num_samples; idx++)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    const double magnitude = 500.0 + 18000.0 * (seed >> 8) / 16777216.0;
+    seed = seed * 1664525u + 1013904223u;
+    const double angle = 2.0 * M_PI * (seed >> 8) / 16777216.0;
+    iq[2 * idx] = lround(magnitude * cos(angle));
+    iq[2 * idx + 1] = lround(magnitude * sin(angle));
+  }
+}
+
+struct s_result
+{
+  double max_phase_error_deg;
+  double rms_phase_error_deg;
+  double max_magnitude_error;
+  double polar_ns;
+  double phase_ns;
+};
+
+template<uint8_t iterations, typename state_t>
+static s_result measure()
+{
+  s_result result = {};
+  uint32_t seed = 1;
+  double phase_error_sum = 0.0;
+  uint64_t polar_ns = 0, phase_ns = 0;
+  volatile int32_t sink = 0;
+
+  for(uint32_t block = 0; block < num_blocks; block++)
+  {
+    int16_t iq[2 * num_samples];
+    uint16_t magnitude[num_samples];
+    int16_t phase[num_samples], phase_only[num_samples];
+    make_block(iq, seed);
+
+    uint64_t start = now_ns();
+    cordic<iterations, state_t>::block(iq, magnitude, phase, num_samples);
+    polar_ns += now_ns() - start;
+    start = now_ns();
+    cordic<iterations, state_t, cordic_phase>::block(iq, NULL, phase_only, num_samples);
+    phase_ns += now_ns() - start;
+
+    for(uint32_t idx = 0; idx < num_samples; idx++)
+    {
+      const double i = iq[2 * idx], q = iq[2 * idx + 1];
+      const int16_t expected_phase = lround(atan2(q, i) * 32768.0 / M_PI);
+      const double phase_error_deg = (int16_t)(phase[idx] - expected_phase) * 180.0 / 32768.0;
+      const double magnitude_error = fabs(magnitude[idx] / hypot(i, q) - 1.0);
+      result.max_phase_error_deg = std::max(result.max_phase_error_deg, fabs(phase_error_deg));
+      result.max_magnitude_error = std::max(result.max_magnitude_error, magnitude_error);
+      phase_error_sum += phase_error_deg * phase_error_deg;
+      sink += phase_only[idx] != phase[idx];
+    }
+  }
+
+  result.rms_phase_error_deg = sqrt(phase_error_sum / (num_blocks * num_samples));
+  result.polar_ns = (double)polar_ns / (num_blocks * num_samples);
+  result.phase_ns = (double)phase_ns / (num_blocks * num_samples);
+  if(sink) printf("phase only output differs\n");
+  return result;
+}
+
+template<uint8_t iterations, typename state_t>
+static bool report(const char *state_name)
+{
+  const s_result result = measure<iterations, state_t>();
+
+  //the residual angle after the last iteration, with a little for the
+  //truncation of each rotation, and the rounding of the angles
+  const double rounding_lsbs = sizeof(state_t) > 2 ? 1.0 : 0.5 * (iterations + 2);
+  const double bound_deg = (1.1 * atan(ldexp(1.0, 1 - iterations)) + rounding_lsbs * M_PI / 32768.0) * 180.0 / M_PI;
+  const bool ok = result.max_phase_error_deg < bound_deg && (iterations < 6 || result.max_magnitude_error < 0.01);
+  printf("%-10u %-8s %10.4f %10.4f %10.4f %9.3f%% %10.1f %10.1f %s\n", iterations, state_name, result.max_phase_error_deg,
+    result.rms_phase_error_deg, bound_deg, 100.0 * result.max_magnitude_error, result.polar_ns, result.phase_ns, ok ? "PASS" : "FAIL");
+  return ok;
+}
+
+int main()
+{
+  bool pass = true;
+
+  printf("%-10s %-8s %10s %10s %10s %10s %10s %10s\n", "iterations", "state", "max deg", "rms deg", "bound deg", "magnitude", "polar ns", "phase ns");
+  pass &= report<4, int32_t>("int32_t");
+  pass &= report<6, int16_t>("int16_t");
+  pass &= report<6, int32_t>("int32_t");
+  pass &= report<8, int32_t>("int32_t");
+  pass &= report<10, int32_t>("int32_t");
+  pass &= report<12, int32_t>("int32_t");
+  pass &= report<15, int32_t>("int32_t");
+
+  //the 6 iteration cordic should match the one it replaced
+  uint32_t differ = 0;
+  for(int32_t i = -32768; i < 32768; i += 97)
+  {
+    for(int32_t q = -32768; q < 32768; q += 89)
+    {
+      uint16_t magnitude, reference_magnitude;
+      int16_t phase, reference_phase;
+      cordic<6, int16_t>::rectangular_2_polar(i, q, magnitude, phase);
+      reference_rectangular_2_polar(i, q, &reference_magnitude, &reference_phase);
+      differ += magnitude != reference_magnitude || phase != reference_phase;
+    }
+  }
+  printf("\n6 iterations, int16_t state, differs from utils.cpp: %u\n", differ);
+  pass &= differ == 0;
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
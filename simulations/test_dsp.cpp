@@ -1,33 +1,40 @@
 #include "../rx_dsp.h"
 #include <cstdio>
+#include <cstdlib>
 
-int main()
+//Read hex ADC samples (interleaved I/Q) from stdin, and write the demodulated
+//audio to stdout. Usage: test_dsp [mode] [offset_Hz]
+int main(int argc, char *argv[])
 {
-  rx_dsp rx_dsp(10e3);
+  const uint8_t mode = argc > 1 ? atoi(argv[1]) : AM;
+  const double offset_Hz = argc > 2 ? atof(argv[2]) : 0.0;
 
-  uint16_t samples[rx_dsp::block_size];
+  //static, like the receiver on the target, so that all state starts at zero
+  static rx_dsp dsp;
+  dsp.set_gain_cal_dB(62);
+  dsp.set_squelch(0, 0);
+  dsp.set_agc_control(3, 10);
+  dsp.set_mode(mode, 2);
+  dsp.set_frequency_offset_Hz(offset_Hz);
 
-  int16_t i[rx_dsp::block_size];
-  int16_t q[rx_dsp::block_size];
+  uint16_t samples[adc_block_size];
+  int16_t audio[adc_block_size/decimation_rate];
 
-  for(uint16_t idx=0; idx<rx_dsp::block_size; idx++)
+  while(true)
   {
-      unsigned int sample;
-      scanf("%x", &sample);
-      samples[idx] = sample;
-  }
+    for(uint16_t idx=0; idx<adc_block_size; idx++)
+    {
+        unsigned int sample;
+        if(scanf("%x", &sample) != 1) return 0;
+        samples[idx] = sample;
+    }
 
-  rx_dsp.process_block(samples, i, q);
-  const uint16_t num_output_samples = rx_dsp.process_block(samples, i, q);
+    const uint16_t num_output_samples = dsp.process_block(samples, audio, NULL);
 
-  for(uint16_t idx=0; idx<num_output_samples; idx++)
-  {
-      if(q[idx] < 0){
-        printf("%0i%0ij, ", i[idx], q[idx]);
-      }
-      else{
-        printf("%0i+%0ij, ", i[idx], q[idx]);
-      }
+    for(uint16_t idx=0; idx<num_output_samples; idx++)
+    {
+        printf("%i\n", audio[idx]);
+    }
   }
 
 }
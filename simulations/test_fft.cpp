@@ -0,0 +1,193 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_fft.cpp
+// description: compare fixed_fft and fixed_fft_radix4 for accuracy and speed
+// License: MIT
+//
+// Both fixed point FFTs are compared against a double precision DFT with the
+// same scaling (1 bit lost every second radix-2 stage). The SNR of each is
+// measured for random complex signals at a few levels, the radix-4 FFT should
+// be at least as accurate as the radix-2 FFT it replaces.
+//
+// The pruned inverse FFT must give exactly the same result as the full
+// inverse FFT when the bins outside its bands are zero.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <ctime>
+
+#include "../fft.h"
+
+typedef void (*fft_function)(int16_t reals[], int16_t imaginaries[], unsigned m);
+
+static void radix2_fft(int16_t reals[], int16_t imaginaries[], unsigned m) { fixed_fft(reals, imaginaries, m); }
+static void radix2_ifft(int16_t reals[], int16_t imaginaries[], unsigned m) { fixed_ifft(reals, imaginaries, m); }
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static void reference_dft(const int16_t reals[], const int16_t imaginaries[], double out_real[], double out_imag[], unsigned m, bool inverse)
+{
+  const unsigned n = 1 << m;
+  const double scale = 1.0 / (1 << (m / 2));
+  const double sign = inverse ? 1.0 : -1.0;
+  for(unsigned k = 0; k < n; ++k)
+  {
+    double sum_real = 0.0, sum_imag = 0.0;
+    for(unsigned t = 0; t < n; ++t)
+    {
+      const double angle = sign * 2.0 * M_PI * (double)((k * t) % n) / n;
+      sum_real += reals[t] * cos(angle) - imaginaries[t] * sin(angle);
+      sum_imag += reals[t] * sin(angle) + imaginaries[t] * cos(angle);
+    }
+    out_real[k] = sum_real * scale;
+    out_imag[k] = sum_imag * scale;
+  }
+}
+
+static double measure_snr(fft_function fft, unsigned m, bool inverse, int16_t amplitude, uint32_t &seed)
+{
+  const unsigned n = 1 << m;
+  double signal = 0.0, error = 0.0;
+  for(unsigned trial = 0; trial < 20; ++trial)
+  {
+    int16_t reals[256], imaginaries[256];
+    for(unsigned i = 0; i < n; ++i)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      reals[i] = (int16_t)((int32_t)(seed >> 16) % (2 * amplitude + 1) - amplitude);
+      seed = seed * 1664525u + 1013904223u;
+      imaginaries[i] = (int16_t)((int32_t)(seed >> 16) % (2 * amplitude + 1) - amplitude);
+    }
+    double expected_real[256], expected_imag[256];
+    reference_dft(reals, imaginaries, expected_real, expected_imag, m, inverse);
+    fft(reals, imaginaries, m);
+    for(unsigned k = 0; k < n; ++k)
+    {
+      signal += expected_real[k] * expected_real[k] + expected_imag[k] * expected_imag[k];
+      const double error_real = reals[k] - expected_real[k];
+      const double error_imag = imaginaries[k] - expected_imag[k];
+      error += error_real * error_real + error_imag * error_imag;
+    }
+  }
+  return 10.0 * log10(signal / error);
+}
+
+static double measure_ns(fft_function fft, unsigned m)
+{
+  const unsigned n = 1 << m;
+  const unsigned repeats = 20000;
+  int16_t reals[256], imaginaries[256];
+  uint32_t seed = 1;
+  for(unsigned i = 0; i < n; ++i)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    reals[i] = (int16_t)(seed >> 20);
+    imaginaries[i] = (int16_t)(seed >> 22);
+  }
+  const uint64_t start = now_ns();
+  for(unsigned repeat = 0; repeat < repeats; ++repeat)
+  {
+    //keep the values bounded, scaling would otherwise reduce them to zero
+    reals[repeat & (n - 1)] = (int16_t)repeat;
+    fft(reals, imaginaries, m);
+  }
+  return (double)(now_ns() - start) / repeats;
+}
+
+int main()
+{
+  fft_initialise();
+
+  bool pass = true;
+  printf("%-12s %5s %10s %12s %12s %12s %12s\n", "transform", "size", "amplitude", "radix2 SNR", "radix4 SNR", "radix2 ns", "radix4 ns");
+
+  struct s_case { const char *name; fft_function radix2, radix4; bool inverse; unsigned m; };
+  const s_case cases[] = {
+    {"fft", radix2_fft, fixed_fft_radix4, false, 8},
+    {"ifft", radix2_ifft, fixed_ifft_radix4, true, 7},
+    {"fft", radix2_fft, fixed_fft_radix4, false, 6},
+    {"ifft", radix2_ifft, fixed_ifft_radix4, true, 5},
+  };
+  const int16_t amplitudes[] = {100, 1000, 4000};
+
+  for(const s_case &c : cases)
+  {
+    const double radix2_ns = measure_ns(c.radix2, c.m);
+    const double radix4_ns = measure_ns(c.radix4, c.m);
+    for(int16_t amplitude : amplitudes)
+    {
+      uint32_t seed = 12345;
+      const double radix2_snr = measure_snr(c.radix2, c.m, c.inverse, amplitude, seed);
+      seed = 12345;
+      const double radix4_snr = measure_snr(c.radix4, c.m, c.inverse, amplitude, seed);
+      const bool ok = radix4_snr >= radix2_snr - 0.5;
+      printf("%-12s %5u %10d %12.1f %12.1f %12.0f %12.0f %s\n", c.name, 1u << c.m, amplitude,
+        radix2_snr, radix4_snr, radix2_ns, radix4_ns, ok ? "PASS" : "FAIL");
+      pass &= ok;
+    }
+  }
+
+  //pruned inverse FFT, bands as used by fft_filter for typical settings
+  struct s_pruned_case { const char *name; uint8_t num_bands; s_fft_band bands[2]; };
+  const s_pruned_case pruned_cases[] = {
+    {"cw", 1, {{0, 2}}},
+    {"ssb", 1, {{3, 22}}},
+    {"am", 2, {{0, 25}, {103, 127}}},
+    {"fm", 2, {{0, 37}, {91, 127}}},
+    {"wrap", 2, {{5, 9}, {120, 127}}},
+  };
+
+  printf("\n%-12s %12s %12s\n", "pruned ifft", "full ns", "pruned ns");
+  for(const s_pruned_case &c : pruned_cases)
+  {
+    const unsigned m = 7, n = 1 << m;
+    int16_t reals[128], imaginaries[128];
+    uint32_t seed = 99;
+    for(unsigned i = 0; i < n; ++i)
+    {
+      bool active = false;
+      for(uint8_t band = 0; band < c.num_bands; ++band) active |= i >= c.bands[band].first && i <= c.bands[band].last;
+      seed = seed * 1664525u + 1013904223u;
+      reals[i] = active ? (int16_t)(seed >> 20) - 2048 : 0;
+      seed = seed * 1664525u + 1013904223u;
+      imaginaries[i] = active ? (int16_t)(seed >> 20) - 2048 : 0;
+    }
+
+    int16_t full_reals[128], full_imaginaries[128], pruned_reals[128], pruned_imaginaries[128];
+    const unsigned repeats = 20000;
+    uint64_t start = now_ns();
+    for(unsigned repeat = 0; repeat < repeats; ++repeat)
+    {
+      for(unsigned i = 0; i < n; ++i) { full_reals[i] = reals[i]; full_imaginaries[i] = imaginaries[i]; }
+      fixed_ifft_radix4(full_reals, full_imaginaries, m);
+    }
+    const double full_ns = (double)(now_ns() - start) / repeats;
+    start = now_ns();
+    for(unsigned repeat = 0; repeat < repeats; ++repeat)
+    {
+      for(unsigned i = 0; i < n; ++i) { pruned_reals[i] = reals[i]; pruned_imaginaries[i] = imaginaries[i]; }
+      fixed_ifft_radix4_pruned(pruned_reals, pruned_imaginaries, m, c.bands, c.num_bands);
+    }
+    const double pruned_ns = (double)(now_ns() - start) / repeats;
+
+    bool exact = true;
+    for(unsigned i = 0; i < n; ++i) exact &= full_reals[i] == pruned_reals[i] && full_imaginaries[i] == pruned_imaginaries[i];
+    printf("%-12s %12.0f %12.0f %s\n", c.name, full_ns, pruned_ns, exact ? "PASS" : "FAIL");
+    pass &= exact;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_fft_filter_path.cpp
+// description: check the FFT filter output against the original path
+// License: MIT
+//
+// process_sample windows the input and writes it in bit reversed order as it
+// is loaded, and takes the overlap from the second half of the last inverse
+// FFT in place. Originally the input was loaded in order, windowed in a
+// separate pass, bit reversed by the FFT, and the overlap was copied out. The
+// same noise and tones are filtered with several pass bands at each FFT size,
+// and a hash of the output samples is compared with the hash recorded from
+// the original path. The samples should be identical.
+
+#include <cstdio>
+#include <cstdint>
+
+#include "../fft_filter.h"
+
+static const uint16_t num_blocks = 200;
+
+struct s_case
+{
+  int16_t low_edge_Hz;
+  int16_t high_edge_Hz;
+  uint32_t expected[4]; //hash for 128, 256, 512 and 1024 points
+};
+
+static uint32_t random_sample(uint32_t &seed)
+{
+  seed = seed * 1664525u + 1013904223u;
+  return seed >> 16;
+}
+
+//FNV-1a of every output sample
+template<uint8_t fft_order>
+static uint32_t filter_hash(int16_t low_edge_Hz, int16_t high_edge_Hz)
+{
+  static const uint16_t fft_size = 1u << fft_order;
+  fft_filter<fft_order> *filter = new fft_filter<fft_order>();
+  int16_t capture[fft_size] = {0};
+
+  s_filter_control fc = {};
+  fc.low_edge_Hz = low_edge_Hz;
+  fc.high_edge_Hz = high_edge_Hz;
+  filter->set_mask(fc);
+
+  uint32_t seed = 1, t = 0, hash = 2166136261u;
+  for(uint16_t block = 0; block < num_blocks; ++block)
+  {
+    int16_t iq[fft_size];
+    for(uint16_t idx = 0; idx < fft_size/2; ++idx, ++t)
+    {
+      //a tone every 16 samples, one every 7 samples and noise
+      const int16_t tone = (t & 8) ? 3000 : -3000;
+      const int16_t noise_i = (int16_t)(random_sample(seed) & 0x1fff) - 0x1000;
+      const int16_t noise_q = (int16_t)(random_sample(seed) & 0x1fff) - 0x1000;
+      iq[2*idx] = tone + ((t % 7) < 3 ? 2000 : -2000) + noise_i;
+      iq[2*idx+1] = ((t & 4) ? 3000 : -3000) + noise_q;
+    }
+
+    filter->process_sample(iq, fc, capture);
+
+    for(uint16_t idx = 0; idx < fft_size/2; ++idx)
+    {
+      hash = (hash ^ (uint16_t)iq[idx]) * 16777619u;
+    }
+  }
+
+  delete filter;
+  return hash;
+}
+
+int main()
+{
+  const s_case cases[] = {
+    {  300,  3000, {0x96a31d23u, 0xcc610fdcu, 0xec7687d7u, 0x5a2f190fu}}, //USB
+    {-3000,  -300, {0x5c5d154du, 0xe7854bf6u, 0xc2aa4f38u, 0xc5e9047du}}, //LSB
+    {-4500,  4500, {0xad21e548u, 0xe4d364bbu, 0xc997520fu, 0xe7b97857u}}, //AM
+    { -250,   250, {0x34e9ee75u, 0xa0ea2888u, 0x75021654u, 0x27ccbe9eu}}, //CW
+  };
+  bool pass = true;
+
+  printf("%-8s %8s %6s %10s %10s\n", "low", "high", "points", "hash", "expected");
+  for(const s_case &c : cases)
+  {
+    const uint32_t hashes[4] = {
+      filter_hash<7>(c.low_edge_Hz, c.high_edge_Hz),
+      filter_hash<8>(c.low_edge_Hz, c.high_edge_Hz),
+      filter_hash<9>(c.low_edge_Hz, c.high_edge_Hz),
+      filter_hash<10>(c.low_edge_Hz, c.high_edge_Hz)
+    };
+    for(uint8_t size = 0; size < 4; ++size)
+    {
+      const bool ok = hashes[size] == c.expected[size];
+      printf("%-8d %8d %6u %08x   %08x %s\n", c.low_edge_Hz, c.high_edge_Hz, 128u << size, hashes[size], c.expected[size], ok ? "PASS" : "FAIL");
+      pass &= ok;
+    }
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_fm_discriminator.cpp
+// description: SINAD and time of the two FM discriminators
+// License: MIT
+//
+// A carrier frequency modulated by a 1kHz tone is received in FM with each
+// discriminator, at several deviations and carrier to noise ratios. The
+// SINAD is the power of the audio over the power left once the tone is
+// removed, after the AGC has settled. The demodulator time per block is
+// shown for each. The product discriminator measures the sine of the phase
+// change, and even with a cubic correction it compresses the largest
+// deviations, so at 3kHz it is only shown. Without the steps of the 6
+// iteration cordic phase it should be within 1dB or better up to 2kHz.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+
+#include "../rx_dsp.h"
+
+static const double iq_sample_rate = adc_sample_rate / 2.0;
+static const double offset_Hz = 10e3;
+static const double tone_Hz = 1000.0;
+static const uint16_t num_audio_samples = adc_block_size / decimation_rate;
+
+static double gaussian(uint32_t &seed)
+{
+  double sum = 0.0;
+  for(uint8_t n = 0; n < 12; ++n)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    sum += (double)(seed >> 8) / 16777216.0;
+  }
+  return sum - 6.0;
+}
+
+struct s_result
+{
+  double sinad_dB;
+  double demod_ns;
+};
+
+static s_result receive(uint8_t discriminator, double deviation_Hz, double cnr_dB)
+{
+  const uint32_t settle_blocks = 1000, measure_blocks = 500;
+  const double amplitude = 500.0;
+
+  //noise power in the FM pass band, about 8.8kHz, relative to the carrier
+  const double noise = amplitude / sqrt(2.0) * pow(10.0, -cnr_dB / 20.0) * sqrt(iq_sample_rate / 8800.0) / sqrt(2.0);
+
+  rx_dsp *dsp = new rx_dsp();
+  dsp->set_gain_cal_dB(62);
+  dsp->set_squelch(0, 0);
+  dsp->set_agc_control(1, 10);
+  dsp->set_mode(FM, 2);
+  dsp->set_frequency_offset_Hz(offset_Hz);
+  dsp->set_fm_discriminator(discriminator);
+
+  uint32_t seed = 1, t = 0, audio_t = 0;
+  double carrier_phase = 0.0;
+  double sum_cos = 0.0, sum_sin = 0.0, sum = 0.0, sum_squares = 0.0;
+  static int16_t audio_capture[measure_blocks * num_audio_samples];
+
+  for(uint32_t block = 0; block < settle_blocks + measure_blocks; ++block)
+  {
+    uint16_t samples[adc_block_size];
+    for(uint16_t idx = 0; idx < adc_block_size; idx += 2, ++t)
+    {
+      const double frequency_Hz = offset_Hz + deviation_Hz * sin(2.0 * M_PI * tone_Hz * t / iq_sample_rate);
+      carrier_phase += 2.0 * M_PI * frequency_Hz / iq_sample_rate;
+      const std::complex<double> iq = std::polar(amplitude, carrier_phase);
+      samples[idx] = 2048 + lround(iq.real() + noise * gaussian(seed));
+      samples[idx + 1] = 2048 + lround(iq.imag() + noise * gaussian(seed));
+    }
+    int16_t audio[num_audio_samples];
+    if(block == settle_blocks) dsp->profile.reset();
+    dsp->process_block(samples, audio, NULL);
+    if(block < settle_blocks) continue;
+
+    for(uint16_t idx = 0; idx < num_audio_samples; ++idx, ++audio_t)
+    {
+      const double phase = 2.0 * M_PI * tone_Hz * audio_t / audio_sample_rate;
+      sum_cos += audio[idx] * cos(phase);
+      sum_sin += audio[idx] * sin(phase);
+      sum += audio[idx];
+      sum_squares += (double)audio[idx] * audio[idx];
+      audio_capture[(block - settle_blocks) * num_audio_samples + idx] = audio[idx];
+    }
+  }
+  const uint64_t demod_ns = dsp->profile.total[dsp_stage_demodulate];
+  delete dsp;
+
+  //remove the tone (and DC) with a least squares fit, what is left is noise
+  //and distortion
+  const uint32_t n = measure_blocks * num_audio_samples;
+  const double a = 2.0 * sum_cos / n, b = 2.0 * sum_sin / n, dc = sum / n;
+  double residual = 0.0;
+  for(uint32_t idx = 0; idx < n; ++idx)
+  {
+    const double phase = 2.0 * M_PI * tone_Hz * idx / audio_sample_rate;
+    const double error = audio_capture[idx] - dc - a * cos(phase) - b * sin(phase);
+    residual += error * error;
+  }
+  const double total = sum_squares - n * dc * dc;
+
+  s_result result;
+  result.sinad_dB = 10.0 * log10(total / residual);
+  result.demod_ns = (double)demod_ns / measure_blocks;
+  return result;
+}
+
+int main()
+{
+  const double deviations_Hz[] = {1000.0, 2000.0, 3000.0};
+  const double cnrs_dB[] = {10.0, 20.0, 40.0};
+  bool pass = true;
+
+  printf("%-10s %8s %12s %12s %12s %12s\n", "deviation", "CNR dB", "phase dB", "product dB", "phase ns", "product ns");
+  for(double deviation_Hz : deviations_Hz)
+  {
+    for(double cnr_dB : cnrs_dB)
+    {
+      const s_result phase = receive(fm_discriminator_phase, deviation_Hz, cnr_dB);
+      const s_result product = receive(fm_discriminator_product, deviation_Hz, cnr_dB);
+      const bool ok = deviation_Hz > 2000.0 || (product.sinad_dB > phase.sinad_dB - 1.0 && (cnr_dB < 20.0 || product.sinad_dB > 12.0));
+      printf("%-10.0f %8.0f %12.1f %12.1f %12.0f %12.0f %s\n", deviation_Hz, cnr_dB, phase.sinad_dB, product.sinad_dB, phase.demod_ns, product.demod_ns,
+        deviation_Hz > 2000.0 ? "" : ok ? "PASS" : "FAIL");
+      pass &= ok;
+    }
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
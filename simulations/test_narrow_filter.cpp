@@ -0,0 +1,128 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_narrow_filter.cpp
+// description: check the response of the multirate narrow CW filter
+// License: MIT
+//
+// A tone is stepped across each narrow pass band, and its level at the output
+// is measured once the filter has settled. The centre of the pass band should
+// be close to 0dB, and the response should fall quickly outside the edges,
+// well inside a single 117Hz bin of the FFT filter. The images left by the
+// interpolator are measured with a tone at the centre of the pass band.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <ctime>
+#include <complex>
+
+#include "../narrow_filter.h"
+
+static const uint16_t block_size = 64;
+static const uint32_t settle_blocks = 40;
+static const uint32_t measure_blocks = 40;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+//level of a tone at the output (dB) relative to the input, and the level of
+//everything else
+static double measure(narrow_filter &filter, int16_t low_edge_Hz, int16_t high_edge_Hz, double frequency_Hz,
+  double &other_dB, uint64_t &elapsed_ns)
+{
+  const double amplitude = 8000.0;
+  std::complex<double> level = 0.0;
+  double power = 0.0;
+  uint32_t t = 0;
+  filter.design(low_edge_Hz, high_edge_Hz);
+  for(uint32_t block = 0; block < settle_blocks + measure_blocks; ++block)
+  {
+    int16_t iq[2 * block_size];
+    std::complex<double> reference[block_size];
+    for(uint16_t idx = 0; idx < block_size; ++idx, ++t)
+    {
+      reference[idx] = std::polar(1.0, 2.0 * M_PI * frequency_Hz * t / audio_sample_rate);
+      iq[2 * idx] = round(amplitude * reference[idx].real());
+      iq[2 * idx + 1] = round(amplitude * reference[idx].imag());
+    }
+    const uint64_t start = now_ns();
+    filter.process_block(iq, block_size);
+    elapsed_ns += now_ns() - start;
+    if(block < settle_blocks) continue;
+    for(uint16_t idx = 0; idx < block_size; ++idx)
+    {
+      const std::complex<double> sample(iq[2 * idx], iq[2 * idx + 1]);
+      level += sample * std::conj(reference[idx]);
+      power += std::norm(sample);
+    }
+  }
+  const uint32_t n = measure_blocks * block_size;
+  level /= n;
+  const double other = std::max(power / n - std::norm(level), 1e-3);
+  other_dB = 10.0 * log10(other / (amplitude * amplitude));
+  return 20.0 * log10(std::max(std::abs(level), 1e-3) / amplitude);
+}
+
+int main()
+{
+  //width, centre, and the frequencies measured from the centre
+  struct s_case {int16_t width_Hz; int16_t centre_Hz;};
+  const s_case cases[] = {{50, 0}, {100, 0}, {200, 0}, {100, 250}, {118, -200}};
+  const int16_t offsets_Hz[] = {0, 20, 60, 100, 200, 400};
+  bool pass = true;
+  uint64_t elapsed_ns = 0, num_blocks = 0;
+
+  printf("%-8s %8s", "width", "centre");
+  for(int16_t offset_Hz : offsets_Hz) printf(" %7s%+4d", "", offset_Hz);
+  printf(" %10s\n", "image dB");
+
+  for(const s_case &c : cases)
+  {
+    const int16_t low_edge_Hz = c.centre_Hz - c.width_Hz / 2;
+    const int16_t high_edge_Hz = c.centre_Hz + c.width_Hz / 2;
+    printf("%-8d %8d", c.width_Hz, c.centre_Hz);
+    bool ok = true;
+    double image_dB = 0.0;
+    for(int16_t offset_Hz : offsets_Hz)
+    {
+      for(int8_t sign = 1; sign >= -1; sign -= 2)
+      {
+        narrow_filter *filter = new narrow_filter();
+        double other_dB;
+        const double gain_dB = measure(*filter, low_edge_Hz, high_edge_Hz, c.centre_Hz + sign * offset_Hz, other_dB, elapsed_ns);
+        num_blocks += settle_blocks + measure_blocks;
+        delete filter;
+
+        //flat in the pass band, at least 20dB down 35Hz outside the edge
+        //and 40dB down 75Hz outside
+        const double outside_Hz = offset_Hz - c.width_Hz / 2.0;
+        if(offset_Hz == 0)
+        {
+          ok &= fabs(gain_dB) < 0.5;
+          image_dB = other_dB;
+        }
+        if(outside_Hz >= 35.0) ok &= gain_dB < -20.0;
+        if(outside_Hz >= 75.0) ok &= gain_dB < -40.0;
+        if(sign == 1) printf(" %11.1f", gain_dB);
+        if(offset_Hz == 0) break;
+      }
+    }
+    ok &= image_dB < -25.0;
+    printf(" %10.1f %s\n", image_dB, ok ? "PASS" : "FAIL");
+    pass &= ok;
+  }
+
+  printf("%.0f ns per %u sample block\n", (double)elapsed_ns / num_blocks, block_size);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
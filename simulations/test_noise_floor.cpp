@@ -0,0 +1,126 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_noise_floor.cpp
+// description: check the minimum statistics noise floor against known noise
+// License: MIT
+//
+// Bins of complex gaussian noise are fed to noise_floor with each window
+// length. The noise floor of a noise only bin should match the mean noise
+// magnitude, the error shows how well the bias of the minimum is corrected
+// for each window. A keyed carrier should leave the floor of its bin close to
+// the noise, and a steady carrier should raise it. After the noise level steps
+// down, the floor should follow within one window.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "../noise_floor.h"
+#include "../rx_definitions.h"
+#include "../utils.h"
+
+static const uint16_t num_bins = 128;
+static const uint16_t keyed_bin = 20;
+static const uint16_t carrier_bin = 30;
+
+static double gaussian(uint32_t &seed)
+{
+  double sum = 0.0;
+  for(uint8_t n = 0; n < 12; ++n)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    sum += (double)(seed >> 8) / 16777216.0;
+  }
+  return sum - 6.0;
+}
+
+//noise in every bin, a carrier keyed 40 blocks on and 40 off, and a steady
+//carrier
+static void make_block(uint16_t magnitude[], uint32_t block, double noise_level, uint32_t &seed, double &noise_sum)
+{
+  for(uint16_t bin = 0; bin < num_bins; ++bin)
+  {
+    double i = noise_level * gaussian(seed);
+    double q = noise_level * gaussian(seed);
+    if(bin == keyed_bin && (block / 40) % 2) i += 2000.0;
+    if(bin == carrier_bin) i += 2000.0;
+    magnitude[bin] = rectangular_2_magnitude(i, q);
+    if(bin != keyed_bin && bin != carrier_bin) noise_sum += magnitude[bin];
+  }
+}
+
+static double dB(double x)
+{
+  return 20.0 * log10(x);
+}
+
+int main()
+{
+  const uint32_t num_blocks = 20000;
+  bool pass = true;
+
+  printf("%-10s %10s %10s %10s %10s %10s\n", "smoothing", "noise", "floor", "error dB", "keyed dB", "carrier dB");
+  for(int8_t noise_smoothing = 0; noise_smoothing <= 4; ++noise_smoothing)
+  {
+    noise_floor<num_bins> *floors = new noise_floor<num_bins>();
+    uint32_t seed = 1;
+    double noise_sum = 0.0, floor_sum = 0.0, keyed_sum = 0.0, carrier_sum = 0.0;
+    uint32_t count = 0;
+
+    for(uint32_t block = 0; block < num_blocks; ++block)
+    {
+      uint16_t magnitude[num_bins];
+      make_block(magnitude, block, 300.0, seed, noise_sum);
+      for(uint16_t bin = 0; bin < num_bins; ++bin) floors->update(bin, magnitude[bin]);
+      floors->end_block(noise_smoothing);
+
+      //skip the first windows while the floor settles
+      if(block < num_blocks / 4) continue;
+      for(uint16_t bin = 0; bin < num_bins; ++bin)
+      {
+        if(bin == keyed_bin || bin == carrier_bin) continue;
+        floor_sum += (*floors)[bin].noise;
+      }
+      keyed_sum += (*floors)[keyed_bin].noise;
+      carrier_sum += (*floors)[carrier_bin].noise;
+      count++;
+    }
+
+    const double mean_noise = noise_sum / ((double)num_blocks * (num_bins - 2));
+    const double mean_floor = floor_sum / ((double)count * (num_bins - 2));
+    const double error_dB = dB(mean_floor / mean_noise);
+    const double keyed_dB = dB(keyed_sum / count / mean_noise);
+    const double carrier_dB = dB(carrier_sum / count / mean_noise);
+
+    const bool ok = fabs(error_dB) < 1.0 && keyed_dB < 2.0 && carrier_dB > 10.0;
+    printf("%-10d %10.1f %10.1f %10.2f %10.2f %10.2f %s\n", noise_smoothing, mean_noise, mean_floor, error_dB,
+      keyed_dB, carrier_dB, ok ? "PASS" : "FAIL");
+    pass &= ok;
+
+    //step the noise down by 20dB, the floor should follow within a window
+    const uint32_t window_blocks = 4u * (adc_sample_rate / (cic_decimation_rate * num_bins * 16u)) << noise_smoothing;
+    for(uint32_t block = 0; block < window_blocks + 50; ++block)
+    {
+      uint16_t magnitude[num_bins];
+      double quiet_sum = 0.0;
+      make_block(magnitude, block, 30.0, seed, quiet_sum);
+      for(uint16_t bin = 0; bin < num_bins; ++bin) floors->update(bin, magnitude[bin]);
+      floors->end_block(noise_smoothing);
+    }
+    const bool follows = (*floors)[0].noise < mean_floor / 5.0;
+    if(!follows) printf("noise floor did not follow a step down, %u\n", (*floors)[0].noise);
+    pass &= follows;
+
+    delete floors;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_noise_reduction.cpp
+// description: compare noise_reduction with a reference using divisions
+// License: MIT
+//
+// The reference is the noise reduction gain used before the reciprocal
+// lookup, with two divisions per bin. Its adaptive threshold table is
+// regenerated from the formula in noise_canceler_constants.py. Both are fed
+// the same spectra (a few steady tones and a fading tone in noise) and the
+// same noise floor estimates with each threshold setting, and the differences
+// in their outputs and their times are reported.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+#include "../noise_reduction.h"
+#include "../utils.h"
+
+static const uint16_t num_bins = 128;
+
+static uint64_t now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+struct reference_noise_reduction
+{
+  static const uint8_t fraction_bits = 15u;
+  static const int32_t scaling = (1<<fraction_bits)-1;
+  static const uint16_t lut_size = 378;
+  uint32_t adaptive_threshold_lut[lut_size];
+
+  reference_noise_reduction()
+  {
+    //alpha falls linearly in dB from 6 at -5dB to 1 at 20dB
+    const double a = -(6.0 - 1.0) / (20.0 - -5.0);
+    const double b = 6.0 - a * -5.0;
+    for(uint16_t idx = 0; idx < lut_size; ++idx)
+    {
+      const double x = pow(10.0, -5.0/20.0) + 0.025 * idx;
+      const double alpha = std::min(std::max(a * 20.0 * log10(x) + b, 1.0), 6.0);
+      adaptive_threshold_lut[idx] = round(alpha * scaling);
+    }
+  }
+
+  void process(int16_t i[], int16_t q[], const s_noise_estimate estimate[], uint16_t start, uint16_t stop, const int8_t threshold)
+  {
+    for(uint16_t idx = start; idx <= stop; ++idx)
+    {
+      const int32_t signal_level = estimate[idx].signal;
+      const int32_t noise = std::max(estimate[idx].noise, (uint16_t)1);
+      const uint32_t snr = ((uint64_t)signal_level * scaling) / noise;
+
+      uint32_t adaptive_threshold = threshold*scaling;
+      if(threshold == 0)
+      {
+        if(snr < (uint32_t)(0.5623413251903491 * scaling)) adaptive_threshold = 6*scaling;
+        else if(snr > (uint32_t)(10.0 * scaling)) adaptive_threshold = scaling;
+        else adaptive_threshold = adaptive_threshold_lut[std::min((snr - (uint32_t)(0.5623413251903491 * scaling)) / 818u, lut_size - 1u)];
+      }
+
+      int32_t gain = 0;
+      if(signal_level > 0)
+      {
+        gain = std::max((int64_t)scaling - (int64_t)adaptive_threshold*noise/signal_level, (int64_t)0);
+        gain = std::min(gain, scaling);
+      }
+
+      i[idx] = (i[idx]*gain)>>fraction_bits;
+      q[idx] = (q[idx]*gain)>>fraction_bits;
+    }
+  }
+};
+
+//a few steady tones, and one fading in and out, in complex gaussian noise
+static void make_spectrum(int16_t i[], int16_t q[], uint32_t block, uint32_t &seed)
+{
+  for(uint16_t bin = 0; bin < num_bins; ++bin)
+  {
+    double noise_i = 0.0, noise_q = 0.0;
+    for(uint8_t n = 0; n < 4; ++n)
+    {
+      seed = seed * 1664525u + 1013904223u;
+      noise_i += (double)(seed >> 16) / 65536.0 - 0.5;
+      seed = seed * 1664525u + 1013904223u;
+      noise_q += (double)(seed >> 16) / 65536.0 - 0.5;
+    }
+    double amplitude = 0.0;
+    if(bin == 10) amplitude = 3000.0;
+    if(bin == 40) amplitude = 400.0;
+    if(bin == 41) amplitude = 150.0;
+    if(bin == 90) amplitude = 2000.0 * (0.5 + 0.5 * sin(2.0 * M_PI * block / 200.0));
+    const double phase = 0.7 * block + bin;
+    i[bin] = amplitude * cos(phase) + 200.0 * noise_i;
+    q[bin] = amplitude * sin(phase) + 200.0 * noise_q;
+  }
+}
+
+int main()
+{
+  const uint32_t num_blocks = 2000;
+  const int8_t noise_smoothing = 2;
+  bool pass = true;
+
+  printf("%-10s %10s %10s %10s %12s %12s %12s\n", "threshold", "differ", "max error", "error dB", "reference ns", "lookup ns", "");
+
+  for(int8_t threshold = 0; threshold <= 4; ++threshold)
+  {
+    reference_noise_reduction *reference = new reference_noise_reduction();
+    noise_floor<num_bins> *floors = new noise_floor<num_bins>();
+
+    uint32_t seed = 1, differ = 0;
+    int32_t max_error = 0;
+    double signal_power = 0.0, error_power = 0.0;
+    uint64_t reference_ns = 0, lookup_ns = 0;
+
+    for(uint32_t block = 0; block < num_blocks; ++block)
+    {
+      int16_t reference_i[num_bins], reference_q[num_bins], lookup_i[num_bins], lookup_q[num_bins];
+      make_spectrum(reference_i, reference_q, block, seed);
+      for(uint16_t bin = 0; bin < num_bins; ++bin) floors->update(bin, rectangular_2_magnitude(reference_i[bin], reference_q[bin]));
+      floors->end_block(noise_smoothing);
+      std::copy(reference_i, reference_i + num_bins, lookup_i);
+      std::copy(reference_q, reference_q + num_bins, lookup_q);
+
+      uint64_t start = now_ns();
+      reference->process(reference_i, reference_q, floors->estimates(), 0, num_bins - 1, threshold);
+      reference_ns += now_ns() - start;
+      start = now_ns();
+      noise_reduction(lookup_i, lookup_q, floors->estimates(), 0, num_bins - 1, threshold);
+      lookup_ns += now_ns() - start;
+
+      for(uint16_t bin = 0; bin < num_bins; ++bin)
+      {
+        const int32_t error_i = lookup_i[bin] - reference_i[bin];
+        const int32_t error_q = lookup_q[bin] - reference_q[bin];
+        differ += (error_i != 0) + (error_q != 0);
+        max_error = std::max(max_error, std::max(abs(error_i), abs(error_q)));
+        signal_power += (double)reference_i[bin] * reference_i[bin] + (double)reference_q[bin] * reference_q[bin];
+        error_power += (double)error_i * error_i + (double)error_q * error_q;
+      }
+    }
+
+    //the gain is within about 0.2% of the reference, except at the edges of
+    //the adaptive threshold table, where an index can move by one entry
+    const double error_dB = error_power > 0.0 ? 10.0 * log10(error_power / signal_power) : -INFINITY;
+    const bool ok = error_dB < -40.0;
+    printf("%-10d %9.2f%% %10d %10.1f %12.0f %12.0f %s\n", threshold, 100.0 * differ / (2.0 * num_bins * num_blocks),
+      max_error, error_dB, (double)reference_ns / num_blocks, (double)lookup_ns / num_blocks, ok ? "PASS" : "FAIL");
+    pass &= ok;
+    delete reference;
+    delete floors;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
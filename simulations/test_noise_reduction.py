@@ -4,7 +4,7 @@ from subprocess import run, PIPE, Popen
 
 
 #build and run test harness
-run(["g++", "-DSIMULATION=true", "../utils.cpp", "../noise_reduction.cpp", "noise_reduction_test.cpp", "-o", "noise_reduction_test"])
+run(["g++", "-DSIMULATION=true", "-Ipico_stubs", "../utils.cpp", "../noise_reduction.cpp", "../noise_floor.cpp", "noise_reduction_test.cpp", "-o", "noise_reduction_test"])
 uut = Popen("./noise_reduction_test", stdin=PIPE, stdout=PIPE)
 
 
@@ -0,0 +1,203 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_settings_continuity.cpp
+// description: check that audio is continuous when settings change mid-stream
+// License: MIT
+//
+// Settings are applied at a block boundary while the receiver keeps
+// streaming. Each change is published through the settings snapshot, as the
+// UI does on core 0, then read and applied at a block boundary, as the stream
+// does on core 1. Changes that can be applied while streaming must not ask
+// for a restart, and must be counted in restarts_avoided. The audio around
+// the change is compared with the audio before it, there should be no gap
+// (run of silence) and no large drop in level. For comparison, a restart of
+// the stream loses at least one ADC block and mutes the first output block.
+// Switching to the external NCO changes the system clock, and must restart.
+// A retune within the IF only changes the offset, which rx::tune publishes
+// through the same snapshot.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "../rx_dsp.h"
+#include "../rx_settings.h"
+#include "../rx_definitions.h"
+
+static const uint16_t audio_block_size = adc_block_size/decimation_rate;
+static const uint32_t num_blocks = 200;
+static const uint32_t change_block = 120;
+
+//AM modulated carrier with a little noise, as in benchmark_dsp
+static void make_adc_block(uint16_t samples[], uint32_t &t, uint32_t &seed)
+{
+  const double carrier_Hz = 10e3;
+  const double modulation_Hz = 400.0;
+  const double iq_sample_rate = adc_sample_rate/2.0;
+
+  for(uint16_t idx=0; idx<adc_block_size; idx+=2)
+  {
+    const double time = (double)t++/iq_sample_rate;
+    const double envelope = 1.0 + 0.5*sin(2.0*M_PI*modulation_Hz*time);
+    const double i = 400.0*envelope*cos(2.0*M_PI*carrier_Hz*time);
+    const double q = 400.0*envelope*sin(2.0*M_PI*carrier_Hz*time);
+    seed = seed * 1664525u + 1013904223u;
+    const int16_t noise_i = (seed >> 24) & 0x1f;
+    seed = seed * 1664525u + 1013904223u;
+    const int16_t noise_q = (seed >> 24) & 0x1f;
+    samples[idx] = 2048 + (int16_t)i + noise_i;
+    samples[idx + 1] = 2048 + (int16_t)q + noise_q;
+  }
+}
+
+static void change_bandwidth(rx_settings &settings) { settings.bandwidth = 3; }
+static void change_agc(rx_settings &settings) { settings.agc_setting = 0; }
+static void change_noise_reduction(rx_settings &settings) { settings.enable_noise_reduction = true; }
+static void change_tone(rx_settings &settings) { settings.treble = 2; settings.bass = 2; }
+static void change_deemphasis(rx_settings &settings) { settings.deemphasis = 1; }
+static void change_mode(rx_settings &settings) { settings.mode = AMSYNC; }
+static void change_squelch(rx_settings &settings) { settings.squelch_timeout = 3; }
+static void change_external_nco(rx_settings &settings) { settings.enable_external_nco = true; }
+static void change_offset(rx_settings &settings) { settings.offset_frequency_Hz = 10.05e3; }
+
+struct s_change
+{
+  const char *name;
+  void (*apply)(rx_settings &settings);
+  bool restart;
+};
+
+static const s_change changes[] = {
+  {"bandwidth", change_bandwidth, false},
+  {"agc", change_agc, false},
+  {"noise_reduction", change_noise_reduction, false},
+  {"tone", change_tone, false},
+  {"deemphasis", change_deemphasis, false},
+  {"mode", change_mode, false},
+  {"squelch", change_squelch, false},
+  {"offset", change_offset, false},
+  {"external_nco", change_external_nco, true},
+};
+
+//the settings of the receiver before the change
+static rx_settings initial_settings()
+{
+  rx_settings settings = {};
+  settings.agc_setting = 3;
+  settings.agc_gain = 10;
+  settings.mode = AM;
+  settings.volume = 5;
+  settings.bandwidth = 2;
+  settings.fft_tone_controls = true;
+  settings.cw_sidetone_Hz = 1000;
+  settings.gain_cal = 62;
+  settings.noise_estimation = 2;
+  settings.spectrum_smoothing = 1;
+  settings.offset_frequency_Hz = 10e3;
+  return settings;
+}
+
+//pick up a new snapshot at a block boundary, as rx::stream does
+static bool apply_snapshot(settings_snapshot &snapshot, rx_dsp &dsp, bool &restart)
+{
+  rx_settings settings;
+  bool first;
+  if(!snapshot.read(settings, first)) return false;
+  restart = apply_dsp_settings(dsp, settings, snapshot.get_applied(), first);
+  snapshot.applied(settings, first, restart);
+  return true;
+}
+
+static double block_rms(const int16_t audio[])
+{
+  double sum = 0.0;
+  for(uint16_t idx = 0; idx < audio_block_size; ++idx) sum += (double)audio[idx]*audio[idx];
+  return sqrt(sum/audio_block_size);
+}
+
+int main()
+{
+  static uint16_t adc_blocks[num_blocks][adc_block_size];
+  uint32_t t = 0, seed = 1;
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    make_adc_block(adc_blocks[block], t, seed);
+  }
+
+  bool pass = true;
+  printf("%-16s %8s %8s %12s %12s %12s\n", "change", "restart", "avoided", "rms before", "rms after", "longest gap");
+
+  //static, so that all state starts zeroed as it does on the target
+  static rx_dsp dsp_instances[sizeof(changes)/sizeof(changes[0])];
+  static settings_snapshot snapshots[sizeof(changes)/sizeof(changes[0])];
+  for(const s_change &change : changes)
+  {
+    rx_dsp *dsp = &dsp_instances[&change - changes];
+    settings_snapshot &snapshot = snapshots[&change - changes];
+
+    //the first snapshot is applied in full
+    rx_settings settings = initial_settings();
+    snapshot.publish(settings);
+    bool restart = false;
+    bool ok = apply_snapshot(snapshot, *dsp, restart) && !restart;
+
+    double rms_before = 0.0;
+    double min_rms_after = 1e9;
+    uint32_t silent_run = 0, longest_gap = 0;
+
+    for(uint32_t block = 0; block < num_blocks; ++block)
+    {
+      //publish the change, it is applied at the next block boundary
+      if(block == change_block)
+      {
+        change.apply(settings);
+        snapshot.publish(settings);
+        ok &= apply_snapshot(snapshot, *dsp, restart);
+        ok &= restart == change.restart;
+        ok &= snapshot.get_restarts_avoided() == (change.restart ? 0u : 1u);
+      }
+
+      //nothing new to apply at the following block
+      if(block == change_block + 1)
+      {
+        bool unused;
+        ok &= !apply_snapshot(snapshot, *dsp, unused);
+      }
+
+      int16_t audio[audio_block_size];
+      dsp->process_block(adc_blocks[block], audio, NULL);
+
+      const double rms = block_rms(audio);
+      if(block >= change_block - 8 && block < change_block) rms_before += rms/8;
+      if(block >= change_block && block < change_block + 16 && rms < min_rms_after) min_rms_after = rms;
+
+      //measure runs of silence from shortly before the change
+      if(block < change_block - 8) continue;
+      for(uint16_t idx = 0; idx < audio_block_size; ++idx)
+      {
+        silent_run = (abs(audio[idx]) <= 1) ? silent_run + 1 : 0;
+        if(silent_run > longest_gap) longest_gap = silent_run;
+      }
+    }
+
+    //a 400Hz tone never stays at zero for more than a few samples, the level
+    //may dip while the new settings settle (e.g. noise reduction adapting).
+    //A change that needs a restart would stop the stream instead.
+    if(!change.restart) ok &= longest_gap < 8 && min_rms_after > 0.2*rms_before;
+    printf("%-16s %8s %8lu %12.1f %12.1f %12u %s\n", change.name, restart ? "yes" : "no",
+      (unsigned long)snapshot.get_restarts_avoided(), rms_before, min_rms_after, longest_gap, ok ? "PASS" : "FAIL");
+    pass &= ok;
+  }
+
+  printf("\nrestarting the stream instead would lose at least %u samples (%.1f ms)\n",
+    2*audio_block_size, 2e3*audio_block_size/audio_sample_rate);
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+#include "../spsc_ring.h"
+#include <cstdio>
+#include <thread>
+
+#define CHECK(x) if(!(x)) { printf("FAIL line %u: %s\n", __LINE__, #x); return 1; }
+
+int main()
+{
+  //single threaded: wrap, overflow and high water mark
+  {
+    static spsc_ring<uint32_t, 16> ring;
+    uint32_t data[12];
+    for(uint32_t idx = 0; idx < 12; ++idx) data[idx] = idx;
+
+    CHECK(ring.push_block(data, 12) == 12);
+    const uint32_t *span;
+    CHECK(ring.peek_span(span) == 12);
+    CHECK(span[0] == 0 && span[11] == 11);
+    ring.consume(10);
+
+    //wraps after 4 elements
+    CHECK(ring.push_block(data, 12) == 12);
+    CHECK(ring.get_level() == 14);
+    CHECK(ring.peek_span(span) == 6);
+    CHECK(span[0] == 10 && span[2] == 0 && span[5] == 3);
+    ring.consume(6);
+    CHECK(ring.peek_span(span) == 8);
+    CHECK(span[0] == 4 && span[7] == 11);
+
+    //only 8 spaces left
+    CHECK(ring.push_block(data, 12) == 8);
+    CHECK(ring.get_overflows() == 4);
+    CHECK(ring.get_high_water_mark() == 16);
+  }
+
+  //two threads: every sample arrives in order, or is counted as dropped
+  {
+    static spsc_ring<uint32_t, 2048> ring;
+    const uint32_t num_blocks = 200000;
+    const uint32_t block_size = 64;
+
+    std::thread producer([&]() {
+      uint32_t block[block_size];
+      uint32_t value = 0;
+      for(uint32_t idx = 0; idx < num_blocks; ++idx)
+      {
+        for(uint32_t j = 0; j < block_size; ++j) block[j] = value + j;
+        value += ring.push_block(block, block_size);
+      }
+    });
+
+    uint32_t expected = 0;
+    bool in_order = true;
+    while(true)
+    {
+      const bool done = expected + ring.get_overflows() == num_blocks * block_size;
+      const uint32_t *span;
+      const uint32_t n = ring.peek_span(span);
+      for(uint32_t j = 0; j < n; ++j) in_order &= (span[j] == expected++);
+      ring.consume(n);
+      if(done && n == 0) break;
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(expected + ring.get_overflows() == num_blocks * block_size);
+  }
+
+  printf("PASS\n");
+  return 0;
+}
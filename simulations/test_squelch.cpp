@@ -0,0 +1,142 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_squelch.cpp
+// description: check the SNR squelch and the squelch timeout in blocks
+// License: MIT
+//
+// A tone hopping between five frequencies, a little like speech, is received
+// in USB at three noise levels 20dB apart. The SNR squelch at 10dB should stay
+// closed on noise alone and open with the tone, at any noise level. The
+// signal strength squelch at a fixed level is shown for comparison. Then the
+// tone stops with each timeout setting, and the audio should fade out after
+// the timeout, counted in blocks, and the release ramp.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+
+#include "../rx_dsp.h"
+
+static const double iq_sample_rate = adc_sample_rate / 2.0;
+static const double offset_Hz = 10e3;
+static const uint16_t num_audio_samples = adc_block_size / decimation_rate;
+
+static double gaussian(uint32_t &seed)
+{
+  double sum = 0.0;
+  for(uint8_t n = 0; n < 12; ++n)
+  {
+    seed = seed * 1664525u + 1013904223u;
+    sum += (double)(seed >> 8) / 16777216.0;
+  }
+  return sum - 6.0;
+}
+
+static rx_dsp *make_dsp(uint8_t threshold, uint8_t timeout, uint8_t type)
+{
+  rx_dsp *dsp = new rx_dsp();
+  dsp->set_gain_cal_dB(62);
+  dsp->set_agc_control(1, 10);
+  dsp->set_mode(USB, 2);
+  dsp->set_frequency_offset_Hz(offset_Hz);
+  dsp->set_squelch(threshold, timeout, type);
+  return dsp;
+}
+
+//receive some blocks, returns true for each block with any audio
+static void receive(rx_dsp &dsp, double noise, double amplitude, uint32_t num_blocks, uint32_t &t, uint32_t &seed, bool open[])
+{
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    //hop every 10 blocks
+    const double tone_Hz = offset_Hz + 600.0 + 400.0 * ((t / (adc_block_size / 2) / 10) % 5);
+    uint16_t samples[adc_block_size];
+    for(uint16_t idx = 0; idx < adc_block_size; idx += 2, ++t)
+    {
+      const std::complex<double> iq = std::polar(amplitude, 2.0 * M_PI * tone_Hz * t / iq_sample_rate);
+      samples[idx] = 2048 + lround(iq.real() + noise * gaussian(seed));
+      samples[idx + 1] = 2048 + lround(iq.imag() + noise * gaussian(seed));
+    }
+    int16_t audio[num_audio_samples];
+    dsp.process_block(samples, audio, NULL);
+    open[block] = false;
+    for(uint16_t idx = 0; idx < num_audio_samples; ++idx) open[block] |= audio[idx] != 0;
+  }
+}
+
+//fraction of blocks with audio, after the noise floor has settled
+static double open_fraction(uint8_t threshold, uint8_t type, double noise, double amplitude)
+{
+  const uint32_t settle_blocks = 300, measure_blocks = 200;
+  static bool open[settle_blocks + measure_blocks];
+  rx_dsp *dsp = make_dsp(threshold, 0, type);
+  uint32_t t = 0, seed = 1, count = 0;
+  receive(*dsp, noise, amplitude, settle_blocks + measure_blocks, t, seed, open);
+  for(uint32_t block = settle_blocks; block < settle_blocks + measure_blocks; ++block) count += open[block];
+  delete dsp;
+  return (double)count / measure_blocks;
+}
+
+int main()
+{
+  const uint8_t snr_10dB = 8, s7 = 7;
+  const double noise_levels[] = {30.0, 100.0, 300.0};
+  bool pass = true;
+
+  printf("%-10s %10s %10s %10s %10s %10s\n", "noise", "tone", "SNR dB", "open", "S7 open", "");
+  for(double noise : noise_levels)
+  {
+    for(double tone : {0.0, 3.0 * noise})
+    {
+      rx_dsp *dsp = make_dsp(snr_10dB, 0, squelch_snr);
+      uint32_t t = 0, seed = 1;
+      static bool open[300];
+      receive(*dsp, noise, tone, 300, t, seed, open);
+      const int16_t snr_dB = dsp->get_snr_dB();
+      delete dsp;
+
+      const double snr_open = open_fraction(snr_10dB, squelch_snr, noise, tone);
+      const double signal_open = open_fraction(s7, squelch_signal_strength, noise, tone);
+      const bool ok = tone > 0.0 ? snr_open > 0.95 : snr_open < 0.05;
+      printf("%-10.0f %10.0f %10d %9.0f%% %9.0f%% %s\n", noise, tone, snr_dB, 100.0 * snr_open, 100.0 * signal_open, ok ? "PASS" : "FAIL");
+      pass &= ok;
+    }
+  }
+
+  //the tone stops, the audio should fade out after the timeout
+  static const uint16_t timeouts_ms[] = {50, 100, 200, 500, 1000, 2000, 3000, 5000};
+  const double block_ms = 1000.0 * num_audio_samples / audio_sample_rate;
+  const uint8_t release_blocks = 4;
+  printf("\n%-10s %10s %10s\n", "timeout", "closed ms", "expected");
+  for(uint8_t timeout = 0; timeout < 8; ++timeout)
+  {
+    const uint8_t s8 = 8;
+    const uint32_t tone_blocks = 200, quiet_blocks = 1500;
+    static bool open[tone_blocks + quiet_blocks];
+    rx_dsp *dsp = make_dsp(s8, timeout, squelch_signal_strength);
+    uint32_t t = 0, seed = 1;
+    receive(*dsp, 30.0, 90.0, tone_blocks, t, seed, open);
+    receive(*dsp, 30.0, 0.0, quiet_blocks, t, seed, &open[tone_blocks]);
+    delete dsp;
+
+    uint32_t last_open = 0;
+    for(uint32_t block = 0; block < tone_blocks + quiet_blocks; ++block) if(open[block]) last_open = block;
+    const double closed_ms = (last_open + 1 - tone_blocks) * block_ms;
+
+    //rounded up to whole blocks, allowing up to three blocks for the filter
+    const double expected_ms = ceil(timeouts_ms[timeout] / block_ms) * block_ms + release_blocks * block_ms;
+    const bool ok = closed_ms >= expected_ms && closed_ms <= expected_ms + 3.0 * block_ms && open[tone_blocks - 1];
+    printf("%-10u %10.1f %10.1f %s\n", timeouts_ms[timeout], closed_ms, expected_ms, ok ? "PASS" : "FAIL");
+    pass &= ok;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
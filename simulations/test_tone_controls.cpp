@@ -0,0 +1,130 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_tone_controls.cpp
+// description: compare tone controls in the FFT filter with the audio filters
+// License: MIT
+//
+// A single tone is received in USB, LSB and AM with manual gain, first with
+// the tone controls applied to each audio sample and then with them applied
+// to the bins of the FFT filter (AM always falls back to the audio filters). The change in the level of the audio tone
+// caused by the tone controls should be the same either way, and both should
+// follow tone_control_gain. The time spent in the FFT filter and the post
+// filters is reported for both.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+
+#include "../rx_dsp.h"
+#include "../tone_controls.h"
+
+static const double iq_sample_rate = adc_sample_rate / 2.0;
+static const double offset_Hz = 10e3;
+static const uint32_t settle_blocks = 150;
+static const uint32_t measure_blocks = 100;
+static const uint16_t num_audio_samples = adc_block_size / decimation_rate;
+
+struct s_setting
+{
+  uint8_t deemphasis, bass, treble;
+};
+
+//level (dB) of the audio tone, and the time per block spent in the FFT filter
+//and the post filters
+static double receive(uint8_t mode, double audio_Hz, const s_setting &setting, bool fft_tone_controls, double &ns)
+{
+  rx_dsp *dsp = new rx_dsp();
+  dsp->set_gain_cal_dB(62);
+  dsp->set_squelch(0, 0);
+  dsp->set_agc_control(4, 0);
+  dsp->set_mode(mode, 4);
+  dsp->set_frequency_offset_Hz(offset_Hz);
+  dsp->set_deemphasis(setting.deemphasis);
+  dsp->set_bass(setting.bass);
+  dsp->set_treble(setting.treble);
+  dsp->set_fft_tone_controls(fft_tone_controls);
+
+  //LSB is received below the carrier, AM is a carrier with 50% modulation
+  const double tone_Hz = offset_Hz + (mode == LSB ? -audio_Hz : audio_Hz);
+  std::complex<double> level = 0.0;
+  uint32_t t = 0, audio_t = 0;
+  for(uint32_t block = 0; block < settle_blocks + measure_blocks; ++block)
+  {
+    uint16_t samples[adc_block_size];
+    for(uint16_t idx = 0; idx < adc_block_size; idx += 2, ++t)
+    {
+      std::complex<double> iq;
+      if(mode == AM)
+      {
+        const double envelope = 1.0 + 0.5 * cos(2.0 * M_PI * audio_Hz * t / iq_sample_rate);
+        iq = std::polar(300.0 * envelope, 2.0 * M_PI * offset_Hz * t / iq_sample_rate);
+      }
+      else
+      {
+        iq = std::polar(300.0, 2.0 * M_PI * tone_Hz * t / iq_sample_rate);
+      }
+      samples[idx] = 2048 + lround(iq.real());
+      samples[idx + 1] = 2048 + lround(iq.imag());
+    }
+    if(block == settle_blocks) dsp->profile.reset();
+    int16_t audio[num_audio_samples];
+    dsp->process_block(samples, audio, NULL);
+    for(uint16_t idx = 0; idx < num_audio_samples; ++idx, ++audio_t)
+    {
+      if(block < settle_blocks) continue;
+      level += (double)audio[idx] * std::polar(1.0, -2.0 * M_PI * audio_Hz * audio_t / audio_sample_rate);
+    }
+  }
+  ns = (double)(dsp->profile.total[dsp_stage_fft_filter] + dsp->profile.total[dsp_stage_post_filters]) / measure_blocks;
+  delete dsp;
+  return 20.0 * log10(std::abs(level) / (measure_blocks * num_audio_samples));
+}
+
+int main()
+{
+  static const char mode_names[6][7] = {"AM", "AMSYNC", "LSB", "USB", "FM", "CW"};
+  const uint8_t modes[] = {USB, LSB, AM};
+  const s_setting settings[] = {{1, 0, 0}, {0, 4, 0}, {0, 0, 4}, {2, 2, 2}};
+  const double frequencies_Hz[] = {400.0, 1000.0, 2000.0, 2800.0};
+  const s_setting flat = {0, 0, 0};
+  bool pass = true;
+  double sample_ns = 0.0, fft_ns = 0.0;
+  uint32_t runs = 0;
+
+  printf("%-5s %-8s %6s %8s %8s %8s\n", "mode", "d/b/t", "Hz", "expect", "sample", "fft");
+  for(uint8_t mode : modes)
+  {
+    for(const s_setting &setting : settings)
+    {
+      for(double frequency_Hz : frequencies_Hz)
+      {
+        double ns;
+        const double flat_dB = receive(mode, frequency_Hz, flat, false, ns);
+        const double sample_dB = receive(mode, frequency_Hz, setting, false, ns) - flat_dB;
+        if(mode != AM) sample_ns += ns;
+        const double fft_dB = receive(mode, frequency_Hz, setting, true, ns) - flat_dB;
+        if(mode != AM) fft_ns += ns;
+        runs += mode != AM;
+        const double expect_dB = 20.0 * log10(tone_control_gain(setting.deemphasis, setting.bass, setting.treble, frequency_Hz));
+
+        //the FFT filter has a coarser frequency resolution, and the bass
+        //shelf is steepest in the lowest bins
+        const bool ok = fabs(sample_dB - expect_dB) < 0.5 && fabs(fft_dB - expect_dB) < 1.0;
+        printf("%-5s %u/%u/%u    %6.0f %8.2f %8.2f %8.2f %s\n", mode_names[mode], setting.deemphasis, setting.bass, setting.treble,
+          frequency_Hz, expect_dB, sample_dB, fft_dB, ok ? "PASS" : "FAIL");
+        pass &= ok;
+      }
+    }
+  }
+
+  printf("SSB fft filter and post filters, per sample %.0f ns/block, in fft %.0f ns/block\n", sample_ns / runs, fft_ns / runs);
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: test_tuning_offset.cpp
+// description: check the tuning offset measured by each demodulator
+// License: MIT
+//
+// AM and FM measure the tuning offset from the phase of every sample, the
+// other modes measure it once per block. A carrier is received a little off
+// frequency in each mode, and the measured offsets should agree whenever the
+// carrier is in the pass band.
+
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <complex>
+
+#include "../rx_dsp.h"
+
+static const double iq_sample_rate = adc_sample_rate / 2.0;
+static const double offset_Hz = 10e3;
+
+static float measure(uint8_t mode, double error_Hz)
+{
+  rx_dsp *dsp = new rx_dsp();
+  dsp->set_gain_cal_dB(62);
+  dsp->set_squelch(0, 0);
+  dsp->set_agc_control(3, 10);
+  dsp->set_mode(mode, 4, 3000);
+  dsp->set_frequency_offset_Hz(offset_Hz);
+
+  //one reading is taken every 30000 audio samples
+  const uint32_t num_blocks = 2 * 30000 / (adc_block_size / decimation_rate) + 2;
+  uint32_t seed = 1, t = 0;
+  float tuning_offset_Hz = 0.0f;
+  for(uint32_t block = 0; block < num_blocks; ++block)
+  {
+    uint16_t samples[adc_block_size];
+    for(uint16_t idx = 0; idx < adc_block_size; idx += 2, ++t)
+    {
+      const std::complex<double> iq = std::polar(300.0, 2.0 * M_PI * (offset_Hz + error_Hz) * t / iq_sample_rate);
+      seed = seed * 1664525u + 1013904223u;
+      samples[idx] = 2048 + lround(iq.real()) + ((seed >> 24) & 0xf);
+      samples[idx + 1] = 2048 + lround(iq.imag()) + ((seed >> 16) & 0xf);
+    }
+    int16_t audio[adc_block_size / decimation_rate];
+    dsp->process_block(samples, audio, NULL);
+    tuning_offset_Hz = dsp->get_tuning_offset_Hz();
+  }
+  delete dsp;
+  return tuning_offset_Hz;
+}
+
+int main()
+{
+  static const char mode_names[6][7] = {"AM", "AMSYNC", "LSB", "USB", "FM", "CW"};
+  const double errors_Hz[] = {-1000.0, -600.0, -20.0, 0.0, 75.0, 400.0, 1200.0};
+  bool pass = true;
+
+  printf("%-8s", "error Hz");
+  for(uint8_t mode = AM; mode <= CW; ++mode) printf(" %8s", mode_names[mode]);
+  printf("\n");
+
+  for(double error_Hz : errors_Hz)
+  {
+    printf("%-8.0f", error_Hz);
+    float reference_Hz = 0.0f;
+    bool ok = true;
+    for(uint8_t mode = AM; mode <= CW; ++mode)
+    {
+      //the sidebands start 293Hz from the carrier, with a tapered edge
+      if((mode == USB && error_Hz < 500.0) || (mode == LSB && error_Hz > -500.0))
+      {
+        printf(" %8s", "-");
+        continue;
+      }
+      const float measured_Hz = measure(mode, error_Hz);
+      if(mode == AM) reference_Hz = measured_Hz;
+      ok &= fabsf(measured_Hz - reference_Hz) < 1.0f;
+      printf(" %8.1f", measured_Hz);
+    }
+    printf(" %s\n", ok ? "PASS" : "FAIL");
+    pass &= ok;
+  }
+
+  printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
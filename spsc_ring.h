@@ -0,0 +1,97 @@
+//  _  ___  _   _____ _     _
+// / |/ _ \/ | |_   _| |__ (_)_ __   __ _ ___
+// | | | | | |   | | | '_ \| | '_ \ / _` / __|
+// | | |_| | |   | | | | | | | | | | (_| \__ \.
+// |_|\___/|_|   |_| |_| |_|_|_| |_|\__, |___/
+//                                  |___/
+//
+// Copyright (c) Jonathan P Dawson 2024
+// filename: spsc_ring.h
+// description: lock-free single producer, single consumer ring buffer
+// License: MIT
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+//Safe to use between cores as long as only one core pushes and only one core
+//consumes. The producer only writes the write index and the consumer only
+//writes the read index, so no locks are needed. Indexes are free running and
+//wrap at 2^32, num_elements must be a power of 2.
+//
+//When the ring is full, new data is dropped and counted as an overflow.
+template <typename T, uint32_t num_elements>
+class spsc_ring
+{
+  static_assert((num_elements & (num_elements - 1)) == 0, "size must be a power of 2");
+  static const uint32_t mask = num_elements - 1;
+
+  T buffer[num_elements];
+  std::atomic<uint32_t> write_index;
+  std::atomic<uint32_t> read_index;
+  std::atomic<uint32_t> overflows;
+  std::atomic<uint32_t> high_water_mark;
+
+  public:
+
+  spsc_ring() : write_index(0), read_index(0), overflows(0), high_water_mark(0) {}
+
+  //producer: copy up to n elements into the ring, returns number written
+  uint32_t push_block(const T data[], uint32_t n)
+  {
+    const uint32_t write = write_index.load(std::memory_order_relaxed);
+    const uint32_t level = write - read_index.load(std::memory_order_acquire);
+    const uint32_t space = num_elements - level;
+    if(n > space)
+    {
+      overflows.store(overflows.load(std::memory_order_relaxed) + n - space, std::memory_order_relaxed);
+      n = space;
+    }
+
+    //copy in up to two parts, before and after the wrap
+    const uint32_t start = write & mask;
+    const uint32_t first = (n < num_elements - start) ? n : num_elements - start;
+    memcpy(&buffer[start], data, first * sizeof(T));
+    memcpy(&buffer[0], data + first, (n - first) * sizeof(T));
+
+    write_index.store(write + n, std::memory_order_release);
+
+    if(level + n > high_water_mark.load(std::memory_order_relaxed))
+    {
+      high_water_mark.store(level + n, std::memory_order_relaxed);
+    }
+    return n;
+  }
+
+  //consumer: get a pointer to the oldest data, returns the number of elements
+  //that can be read contiguously (0 if empty). The data stays valid until it
+  //is consumed.
+  uint32_t peek_span(const T *&data) const
+  {
+    const uint32_t read = read_index.load(std::memory_order_relaxed);
+    const uint32_t level = write_index.load(std::memory_order_acquire) - read;
+    const uint32_t start = read & mask;
+    data = &buffer[start];
+    return (level < num_elements - start) ? level : num_elements - start;
+  }
+
+  //consumer: release n elements previously returned by peek_span
+  void consume(uint32_t n)
+  {
+    read_index.store(read_index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  uint32_t get_level() const
+  {
+    return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire);
+  }
+
+  uint32_t get_overflows() const { return overflows.load(std::memory_order_relaxed); }
+  uint32_t get_high_water_mark() const { return high_water_mark.load(std::memory_order_relaxed); }
+};
+
+#endif
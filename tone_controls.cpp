@@ -0,0 +1,92 @@
+#include "tone_controls.h"
+
+#include <cmath>
+#include <complex>
+#include <algorithm>
+
+#include "rx_definitions.h"
+#include "pico.h"
+
+const int16_t __not_in_flash("deemph_taps") deemph_taps[max_deemphasis][3] = {{14430, 14430, -3909}, {10571, 10571, -11626}};
+
+const int32_t __not_in_flash("treble_taps") treble_taps[max_tone_control][2][3] = {
+    {{26363, -36747, 14207}, {16383, -19828, 7267}},
+    {{42359, -62303, 24741}, {16383, -18062, 6476}},
+    {{67860, -104422, 42534}, {16383, -16114, 5703}},
+    {{108241, -173031, 72157}, {16383, -13987, 4972}}};
+
+const int32_t __not_in_flash("bass_taps") bass_taps[max_tone_control][2][3] = {
+    {{16808, -30178, 13691}, {16383, -30248, 14045}},
+    {{17253, -30437, 13616}, {16383, -30584, 14338}},
+    {{17728, -30637, 13490}, {16383, -30876, 14596}},
+    {{18245, -30777, 13313}, {16383, -31129, 14824}}};
+
+static float biquad_gain(const int32_t taps[2][3], std::complex<float> z1)
+{
+  //the feedback is scaled by 2^14 rather than a0
+  const std::complex<float> z2 = z1 * z1;
+  const std::complex<float> numerator = (float)taps[0][0] + (float)taps[0][1] * z1 + (float)taps[0][2] * z2;
+  const std::complex<float> denominator = (float)(1 << 14) + (float)taps[1][1] * z1 + (float)taps[1][2] * z2;
+  return std::abs(numerator / denominator);
+}
+
+static uint16_t gain_x4096(float gain)
+{
+  return std::min(roundf(gain * 4096.0f), (float)UINT16_MAX);
+}
+
+tone_control_gains::tone_control_gains()
+{
+  for(uint16_t idx = 0; idx < num_points; ++idx)
+  {
+    const float frequency_Hz = (float)(idx << grid_shift) / 256.0f;
+    for(uint8_t setting = 1; setting <= max_deemphasis; ++setting)
+    {
+      deemphasis_gain[setting - 1][idx] = gain_x4096(tone_control_gain(setting, 0, 0, frequency_Hz));
+    }
+    for(uint8_t setting = 1; setting <= max_tone_control; ++setting)
+    {
+      bass_gain[setting - 1][idx] = gain_x4096(tone_control_gain(0, setting, 0, frequency_Hz));
+      treble_gain[setting - 1][idx] = gain_x4096(tone_control_gain(0, 0, setting, frequency_Hz));
+    }
+  }
+}
+
+//interpolate between the points of one filter
+static inline uint32_t interpolate(const uint16_t gains[], uint16_t idx, uint32_t fraction, uint8_t shift)
+{
+  return gains[idx] + (((int32_t)gains[idx + 1] - gains[idx]) * (int32_t)fraction >> shift);
+}
+
+uint32_t __not_in_flash_func(tone_control_gains::gain)(uint8_t deemphasis, uint8_t bass, uint8_t treble, uint32_t frequency_Hz_x256) const
+{
+  //above the last point (only reached with a large CW offset) use the last
+  uint16_t idx = frequency_Hz_x256 >> grid_shift;
+  uint32_t fraction = frequency_Hz_x256 & ((1u << grid_shift) - 1u);
+  if(idx >= num_points - 1u)
+  {
+    idx = num_points - 2u;
+    fraction = 1u << grid_shift;
+  }
+
+  uint32_t gain = 4096u;
+  if(deemphasis) gain = std::min((gain * interpolate(deemphasis_gain[deemphasis - 1], idx, fraction, grid_shift)) >> 12, (uint32_t)UINT16_MAX);
+  if(bass) gain = std::min((gain * interpolate(bass_gain[bass - 1], idx, fraction, grid_shift)) >> 12, (uint32_t)UINT16_MAX);
+  if(treble) gain = std::min((gain * interpolate(treble_gain[treble - 1], idx, fraction, grid_shift)) >> 12, (uint32_t)UINT16_MAX);
+  return gain;
+}
+
+float tone_control_gain(uint8_t deemphasis, uint8_t bass, uint8_t treble, float frequency_Hz)
+{
+  const std::complex<float> z1 = std::polar(1.0f, -2.0f * (float)M_PI * frequency_Hz / audio_sample_rate);
+  float gain = 1.0f;
+  if(deemphasis)
+  {
+    //rx_dsp::apply_deemphasis uses the feedback tap of the first filter
+    const int16_t *taps = deemph_taps[deemphasis - 1];
+    gain *= std::abs(((float)taps[0] + (float)taps[1] * z1) / ((float)(1 << 15) + (float)deemph_taps[0][2] * z1));
+  }
+  if(bass) gain *= biquad_gain(bass_taps[bass - 1], z1);
+  if(treble) gain *= biquad_gain(treble_taps[treble - 1], z1);
+  return gain;
+}
@@ -0,0 +1,41 @@
+#ifndef __TONE_CONTROLS_H__
+#define __TONE_CONTROLS_H__
+
+#include <cstdint>
+
+#include "rx_definitions.h"
+
+//de-emphasis (1st order) and bass/treble shelving (2nd order) filters applied
+//to the audio, at the audio sample rate. The same filters are either applied
+//to each audio sample by rx_dsp, or their combined gain is applied to each bin
+//of the FFT filter.
+const uint8_t max_deemphasis = 2u;
+const uint8_t max_tone_control = 4u;
+
+//b0, b1, a1 (x2^15)
+extern const int16_t deemph_taps[max_deemphasis][3];
+
+//{b0, b1, b2}, {a0, a1, a2} (x2^14)
+extern const int32_t treble_taps[max_tone_control][2][3];
+extern const int32_t bass_taps[max_tone_control][2][3];
+
+//combined gain of the filters at an audio frequency, 0 turns a filter off
+float tone_control_gain(uint8_t deemphasis, uint8_t bass, uint8_t treble, float frequency_Hz);
+
+//the gain (x4096) of each filter on a 32Hz grid up to half the audio sample
+//rate, built once at start up, so that the FFT filter can look up the combined
+//gain of each bin with integer arithmetic
+class tone_control_gains
+{
+  static const uint8_t grid_shift = 13; //32Hz in 1/256Hz
+  static const uint16_t num_points = ((audio_sample_rate << 7) >> grid_shift) + 2u;
+  uint16_t deemphasis_gain[max_deemphasis][num_points];
+  uint16_t bass_gain[max_tone_control][num_points];
+  uint16_t treble_gain[max_tone_control][num_points];
+
+  public:
+  tone_control_gains();
+  uint32_t gain(uint8_t deemphasis, uint8_t bass, uint8_t treble, uint32_t frequency_Hz_x256) const;
+};
+
+#endif
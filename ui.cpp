@@ -353,7 +353,10 @@ void ui::renderpage_original(rx_status & status, rx & receiver)
       u8g2_DrawRBox(&u8g2, i * (seg_w + 1) + seg_x + 2, seg_y+2, seg_w, seg_h, 2);
     }
   }
-  u8g2_DrawVLine(&u8g2, settings.global.squelch_threshold * (seg_w + 1) + seg_x + 2, seg_y, seg_h+4);
+  if(settings.global.squelch_type == squelch_signal_strength)
+  {
+    u8g2_DrawVLine(&u8g2, settings.global.squelch_threshold * (seg_w + 1) + seg_x + 2, seg_y, seg_h+4);
+  }
 
   const char smeter[13][6] = {"S0", "S1", "S2", "S3", "S4", "S5", "S6", "S7", "S8", "S9", "+10", "+20", "+30"};
   u8g2_SetFont(&u8g2, u8g2_font_9x15_tf);
@@ -422,6 +425,39 @@ void ui::renderpage_waterfall(bool view_changed, rx_status & status, rx & receiv
   display_show();
 }
 
+#ifdef DSP_PROFILE
+////////////////////////////////////////////////////////////////////////////////
+// DSP profile, average and maximum time of each stage as % of the block time
+////////////////////////////////////////////////////////////////////////////////
+void ui::renderpage_dsp_profile(rx_status & status, rx & receiver)
+{
+  const s_dsp_profile &profile = receiver.rx_dsp_inst.profile;
+  const float block_ticks = dsp_profile_ticks_per_ms() * 1e3f * adc_block_size / adc_sample_rate;
+
+  display_clear();
+  draw_slim_status(0, status, receiver);
+
+  u8g2_SetDrawColor(&u8g2, 1);
+  u8g2_SetFont(&u8g2, u8g2_font_5x7_tf);
+  u8g2_DrawHLine(&u8g2, 0, 8, 128);
+
+  const uint8_t buffer_size = 23;
+  char buff [buffer_size];
+
+  u8g2_DrawStr(&u8g2, 0, 16, "stage avg/max");
+  u8g2_DrawStr(&u8g2, 64, 16, "stage avg/max");
+  for(uint8_t stage = 0; stage < dsp_num_stages; ++stage)
+  {
+    const unsigned average = std::min(99.0f, 100.0f * profile.average(stage) / block_ticks);
+    const unsigned maximum = std::min(99.0f, 100.0f * profile.max[stage] / block_ticks);
+    snprintf(buff, buffer_size, "%-6.6s%2u/%2u", dsp_stage_names[stage], average, maximum);
+    u8g2_DrawStr(&u8g2, 64 * (stage / 5), 24 + 8 * (stage % 5), buff);
+  }
+
+  display_show();
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Home page status display with big simple text
 ////////////////////////////////////////////////////////////////////////////////
@@ -435,6 +471,7 @@ void ui::renderpage_status(rx_status & status, rx & receiver)
   const float busy_time = ((float)status.busy_time*1e-6f);
   const uint8_t usb_buf_level = status.usb_buf_level;
   const float tuning_offset_Hz = status.tuning_offset_Hz;
+  const uint8_t shed_features = status.shed_features;
   receiver.release();
 
   display_clear();
@@ -460,7 +497,7 @@ void ui::renderpage_status(rx_status & status, rx & receiver)
 
   //cpu load
   y += 10;
-  snprintf(buff, buffer_size, "CPU Load   : %3.0f%%", (100.0f * busy_time) / block_time);
+  snprintf(buff, buffer_size, "CPU Load   : %3.0f%%%s", (100.0f * busy_time) / block_time, shed_features ? " shed" : "");
   u8g2_DrawStr(&u8g2, 0, y, buff);
 
   //usb buffer
@@ -537,6 +574,15 @@ float ui::S_to_dBm(int S) {
   return (dBm);
 }
 
+//the scanners listen when the squelch would open
+bool ui::squelch_threshold_reached(float power_dBm, int16_t snr_dB) {
+  if(settings.global.squelch_type == squelch_snr)
+  {
+    return snr_dB >= squelch_snr_dB[settings.global.squelch_threshold];
+  }
+  return power_dBm >= S_to_dBm(settings.global.squelch_threshold);
+}
+
 int32_t ui::dBm_to_63px(float power_dBm) {
   int32_t power = floorf((power_dBm-S0));
   power = power * 63 / (S9_10 + 20 - S0);
@@ -703,6 +749,7 @@ void ui::renderpage_smeter(bool view_changed, rx_status & status, rx & receiver)
 
   receiver.access(false);
   const float power_dBm = status.signal_strength_dBm;
+  const int16_t snr_dB = status.snr_dB;
   receiver.release();
 
   dBm_avg[dBm_ptr++] = power_dBm;
@@ -732,6 +779,10 @@ void ui::renderpage_smeter(bool view_changed, rx_status & status, rx & receiver)
   // angular meter movement
   draw_analogmeter( 9, 33, 110, 15, percent, 13, "S", labels );
 
+  //signal to noise ratio in the pass band, from the noise floor
+  display_set_xy(0, 54);
+  display_print_num("S/N%3ddB ", snr_dB, 1, style_right);
+
   ssd1306_draw_rectangle(&disp, 0,9,127,54,1);
 
   display_show();
@@ -1314,9 +1365,10 @@ bool ui::memory_scan(bool &ok)
     static float last_power_dBm = FLT_MAX;
     receiver.access(false);
     power_dBm = status.signal_strength_dBm;
+    const int16_t snr_dB = status.snr_dB;
     receiver.release();
     update_display = abs(power_dBm - last_power_dBm) > 1.0f;
-    listen = (power_dBm >= S_to_dBm(settings.global.squelch_threshold));
+    listen = squelch_threshold_reached(power_dBm, snr_dB);
 
     //hang for 3 seconds
     static uint32_t last_listen_time = 0u;
@@ -1516,9 +1568,10 @@ bool ui::frequency_scan(bool &ok)
     static float last_power_dBm = FLT_MAX;
     receiver.access(false);
     power_dBm = status.signal_strength_dBm;
+    const int16_t snr_dB = status.snr_dB;
     receiver.release();
     update_display = abs(power_dBm - last_power_dBm) > 1.0f;
-    listen = (power_dBm >= S_to_dBm(settings.global.squelch_threshold));
+    listen = squelch_threshold_reached(power_dBm, snr_dB);
 
     //hang for 3 seconds
     static uint32_t last_listen_time = 0u;
@@ -2132,6 +2185,129 @@ bool ui::noise_menu(bool & ok)
     return false;
 }
 
+bool ui::filter_menu(bool & ok)
+{
+
+    enum e_ui_state {select_menu_item, menu_item_active};
+    static e_ui_state ui_state = select_menu_item;
+    static uint32_t menu_selection = 0;
+
+    //chose menu item
+    if(ui_state == select_menu_item)
+    {
+      if(menu_entry("Filter", "Bandwidth#Width#IF Shift#", &menu_selection, ok))
+      {
+        if(ok) 
+        {
+          //ok button pressed, more work to do
+          ui_state = menu_item_active;
+          return false;
+        }
+        else
+        {
+          //cancel button pressed, done with menu
+          menu_selection = 0;
+          ui_state = select_menu_item;
+          return true;
+        }
+      }
+    }
+
+    //menu item active
+    else if(ui_state == menu_item_active)
+    {
+       bool done = false;
+       bool changed = false;
+       switch(menu_selection)
+        {
+          case 0 :  
+            done = enumerate_entry("Bandwidth", "V Narrow#Narrow#Normal#Wide#Very Wide#", settings.channel.bandwidth, ok, changed);
+            if(changed) apply_settings(false);
+            break;
+          case 1 : 
+            //0 uses the bandwidth preset
+            done = number_entry("Width Hz\n0=Preset", "%i", 0, max_filter_width, 50, settings.global.filter_width, ok, changed);
+            if(changed) apply_settings(false);
+            break;
+          case 2 : 
+            done = number_entry("IF Shift\nHz", "%i", -max_if_shift, max_if_shift, 50, settings.global.if_shift, ok, changed);
+            if(changed) apply_settings(false);
+            break;
+        }
+        if(done)
+        {
+          menu_selection = 0;
+          ui_state = select_menu_item;
+          return true;
+        }
+    }
+
+    return false;
+}
+
+bool ui::squelch_menu(bool & ok)
+{
+
+    enum e_ui_state {select_menu_item, menu_item_active};
+    static e_ui_state ui_state = select_menu_item;
+    static uint32_t menu_selection = 0;
+
+    //chose menu item
+    if(ui_state == select_menu_item)
+    {
+      if(menu_entry("Squelch", "Type#Level#", &menu_selection, ok))
+      {
+        if(ok) 
+        {
+          //ok button pressed, more work to do
+          ui_state = menu_item_active;
+          return false;
+        }
+        else
+        {
+          //cancel button pressed, done with menu
+          menu_selection = 0;
+          ui_state = select_menu_item;
+          return true;
+        }
+      }
+    }
+
+    //menu item active
+    else if(ui_state == menu_item_active)
+    {
+       bool done = false;
+       bool changed = false;
+       switch(menu_selection)
+        {
+          case 0 :  
+            done = enumerate_entry("Squelch\nType", "Signal#SNR#", settings.global.squelch_type, ok, changed);
+            if(changed) apply_settings(false);
+            break;
+          case 1 : 
+            //the same levels are S units, or SNR in dB
+            if(settings.global.squelch_type == squelch_snr)
+            {
+              done = enumerate_entry("Squelch\nSNR", "0dB#1dB#2dB#3dB#4dB#5dB#6dB#8dB#10dB#12dB#15dB#20dB#25dB#", settings.global.squelch_threshold, ok, changed);
+            }
+            else
+            {
+              done = enumerate_entry("Squelch", "S0#S1#S2#S3#S4#S5#S6#S7#S8#S9#S9+10dB#S9+20dB#S9+30dB#", settings.global.squelch_threshold, ok, changed);
+            }
+            if(changed) apply_settings(false);
+            break;
+        }
+        if(done)
+        {
+          menu_selection = 0;
+          ui_state = select_menu_item;
+          return true;
+        }
+    }
+
+    return false;
+}
+
 bool ui::main_menu(bool & ok)
 {
 
@@ -2142,7 +2318,7 @@ bool ui::main_menu(bool & ok)
     //chose menu item
     if(ui_state == select_menu_item)
     {
-      if(menu_entry("Menu", "Frequency#Recall#Store#Volume#Mode#AGC#AGC Gain#Bandwidth#Squelch#Squelch\nTimeout#Noise\nReduction#Impulse\nBlanker#Auto Notch#De-\nEmphasis#Bass#Treble#IQ\nCorrection#Spectrum#Aux\nDisplay#Band Start#Band Stop#Frequency\nStep#CW Tone\nFrequency#USB Stream#HW Config#", &menu_selection, ok))
+      if(menu_entry("Menu", "Frequency#Recall#Store#Volume#Mode#AGC#AGC Gain#Filter#Squelch#Squelch\nTimeout#Noise\nReduction#Impulse\nBlanker#Auto Notch#De-\nEmphasis#Bass#Treble#IQ\nCorrection#Spectrum#Aux\nDisplay#Band Start#Band Stop#Frequency\nStep#CW Tone\nFrequency#USB Stream#HW Config#FM\nDetector#Tone\nControls#", &menu_selection, ok))
       {
         if(ok) 
         {
@@ -2193,12 +2369,10 @@ bool ui::main_menu(bool & ok)
             if(changed) apply_settings(false);
             break;
           case 7 :  
-            done = enumerate_entry("Bandwidth", "V Narrow#Narrow#Normal#Wide#Very Wide#", settings.channel.bandwidth, ok, changed);
-            if(changed) apply_settings(false);
+            done = filter_menu(ok);
             break;
           case 8 :  
-            done = enumerate_entry("Squelch", "S0#S1#S2#S3#S4#S5#S6#S7#S8#S9#S9+10dB#S9+20dB#S9+30dB#", settings.global.squelch_threshold, ok, changed);
-            if(changed) apply_settings(false);
+            done = squelch_menu(ok);
             break;
           case 9 :  
             done = enumerate_entry("Squelch\nTimeout", "50ms#100ms#200ms#500ms#1s#2s#3s#5s#", settings.global.squelch_timeout, ok, changed);
@@ -2255,6 +2429,14 @@ bool ui::main_menu(bool & ok)
           case 24 : 
             done = configuration_menu(ok);
             break;
+          case 25 :
+            done = enumerate_entry("FM\nDetector", "Phase#Product#", settings.global.fm_discriminator, ok, changed);
+            if(changed) apply_settings(false);
+            break;
+          case 26 :
+            done = enumerate_entry("Tone\nControls", "Per Sample#FFT#", settings.global.tone_controls, ok, changed);
+            if(changed) apply_settings(false);
+            break;
         }
         if(done)
         {
@@ -2441,7 +2623,11 @@ void ui::do_ui()
     bool update_settings = false;
     enum e_ui_state {splash, idle, menu, recall, sleep, memory_scanner, frequency_scanner};
     static e_ui_state ui_state = splash;
+    #ifdef DSP_PROFILE
+    const uint8_t num_display_options = 9;
+    #else
     const uint8_t num_display_options = 8;
+    #endif
     static bool view_changed = false;
 
     if(ui_state != idle) view_changed = true;
@@ -2474,7 +2660,8 @@ void ui::do_ui()
       {
         view_changed = true;
         settings.global.view++;
-        if(settings.global.view==num_display_options){
+        //a view saved by a build with more views wraps too
+        if(settings.global.view>=num_display_options){
           settings.global.view = 0;
           ui_state = memory_scanner;
         }
@@ -2543,6 +2730,9 @@ void ui::do_ui()
         case 5: renderpage_status(status, receiver);break;
         case 6: renderpage_smeter(view_changed, status, receiver); break;
         case 7: renderpage_fun(view_changed, status, receiver);break;
+        #ifdef DSP_PROFILE
+        case 8: renderpage_dsp_profile(status, receiver);break;
+        #endif
       }
       view_changed = false;
     }
@@ -2619,6 +2809,12 @@ void ui::do_ui()
       apply_settings(false);
       autosave();
     }
+
+    //get flash ready for the next autosave while nothing else is happening
+    else if(ui_state == idle)
+    {
+      autosave_erase_ahead(settings, receiver, settings_to_apply);
+    }
 }
 
 #define OLED_I2C_SDA_PIN (18)
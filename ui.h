@@ -116,9 +116,13 @@ class ui
   void renderpage_status(rx_status & status, rx & receiver);
   void renderpage_fun(bool view_changed, rx_status & status, rx & receiver);
   void renderpage_smeter(bool view_changed, rx_status & status, rx & receiver);
+  #ifdef DSP_PROFILE
+  void renderpage_dsp_profile(rx_status & status, rx & receiver);
+  #endif
 
   int dBm_to_S(float power_dBm);
   float S_to_dBm(int S);
+  bool squelch_threshold_reached(float power_dBm, int16_t snr_dB);
   int32_t dBm_to_63px(float power_dBm);
   void log_spectrum(float *min, float *max, int zoom = 1);
   void draw_h_tick_marks(uint16_t startY);
@@ -140,6 +144,8 @@ class ui
   // Menu                    
   bool main_menu(bool &ok);
   bool noise_menu(bool &ok);
+  bool filter_menu(bool &ok);
+  bool squelch_menu(bool &ok);
   bool configuration_menu(bool &ok);
   bool bands_menu(bool &ok);
   bool spectrum_menu(bool &ok);
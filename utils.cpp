@@ -4,52 +4,44 @@
 
 #include "pico/stdlib.h"
 
-#define CORDIC_ITERS (6)
-
 int16_t sin_table[2048];
 
-static const uint32_t CORDIC_GAIN = 39803;
-static int16_t CORDIC_ATAN_LUT[CORDIC_ITERS] = {8192, 4836, 2555, 1297, 651, 326};
-
-void __time_critical_func(rectangular_2_polar)(int16_t i, int16_t q, uint16_t *mag, int16_t *phase) {
-  int16_t temp_i;
-  int16_t angle = 0;
-
-  if (i < 0) {
-    // rotate by an initial +/- 90 degrees
-    temp_i = i;
-    if (q > 0.0f) {
-      i = q; // subtract 90 degrees
-      q = -temp_i;
-      angle = 16384;
-    } else {
-      i = -q; // add 90 degrees
-      q = temp_i;
-      angle = -16384;
-    }
-  }
-
-  for (uint16_t k = 0; k < CORDIC_ITERS; k++) {
-    temp_i = i;
-    if (q > 0) {
-      /* Rotate clockwise */
-      i += (q >> k);
-      q -= (temp_i >> k);
-      angle += CORDIC_ATAN_LUT[k];
-    } else {
-      /* Rotate counterclockwise */
-      i -= (q >> k);
-      q += (temp_i >> k);
-      angle -= CORDIC_ATAN_LUT[k];
-    }
-  }
-
-  *mag = ((uint32_t)i * CORDIC_GAIN) >> 16;
-  *phase = angle;
-}
+//reciprocals of a 9 bit normalised denominator, 2^24/(256.5 + index)
+//See python script simulations/noise_canceler_constants.py
+const uint16_t __not_in_flash("reciprocal_lut") reciprocal_lut[256] = {
+    65408,  65154,  64902,  64652,  64404,  64158,  63913,  63671,  63430,
+    63191,  62954,  62719,  62485,  62253,  62023,  61795,  61568,  61343,
+    61119,  60897,  60677,  60458,  60241,  60026,  59812,  59599,  59388,
+    59179,  58971,  58764,  58559,  58356,  58153,  57952,  57753,  57555,
+    57358,  57163,  56968,  56776,  56584,  56394,  56205,  56017,  55831,
+    55646,  55462,  55279,  55098,  54917,  54738,  54560,  54383,  54207,
+    54033,  53859,  53687,  53516,  53346,  53177,  53009,  52842,  52676,
+    52511,  52347,  52184,  52022,  51862,  51702,  51543,  51385,  51228,
+    51072,  50917,  50763,  50610,  50458,  50306,  50156,  50007,  49858,
+    49710,  49563,  49417,  49272,  49128,  48985,  48842,  48700,  48559,
+    48419,  48280,  48141,  48003,  47867,  47730,  47595,  47460,  47326,
+    47193,  47061,  46929,  46798,  46668,  46539,  46410,  46282,  46155,
+    46028,  45902,  45777,  45652,  45528,  45405,  45283,  45161,  45040,
+    44919,  44799,  44680,  44561,  44443,  44326,  44209,  44093,  43977,
+    43862,  43748,  43634,  43521,  43408,  43296,  43185,  43074,  42963,
+    42854,  42744,  42636,  42528,  42420,  42313,  42207,  42101,  41996,
+    41891,  41786,  41683,  41579,  41476,  41374,  41272,  41171,  41070,
+    40970,  40870,  40771,  40672,  40574,  40476,  40378,  40281,  40185,
+    40089,  39993,  39898,  39804,  39709,  39616,  39522,  39429,  39337,
+    39245,  39153,  39062,  38971,  38881,  38791,  38702,  38613,  38524,
+    38436,  38348,  38260,  38173,  38087,  38000,  37915,  37829,  37744,
+    37659,  37575,  37491,  37407,  37324,  37241,  37159,  37077,  36995,
+    36914,  36833,  36752,  36672,  36592,  36512,  36433,  36354,  36275,
+    36197,  36119,  36041,  35964,  35887,  35810,  35734,  35658,  35583,
+    35507,  35432,  35358,  35283,  35209,  35136,  35062,  34989,  34916,
+    34844,  34771,  34700,  34628,  34557,  34486,  34415,  34344,  34274,
+    34204,  34135,  34065,  33996,  33928,  33859,  33791,  33723,  33655,
+    33588,  33521,  33454,  33387,  33321,  33255,  33189,  33124,  33059,
+    32994,  32929,  32864,  32800,
+};
 
 //from: http://dspguru.com/dsp/tricks/magnitude-estimator/
-uint16_t rectangular_2_magnitude(int16_t i, int16_t q)
+uint16_t __not_in_flash_func(rectangular_2_magnitude)(int16_t i, int16_t q)
 {
   //Measure magnitude
   const int16_t absi = i>0?i:-i;
@@ -4,9 +4,19 @@
 #include <cstdint>
 
 extern int16_t sin_table[2048];
+extern const uint16_t reciprocal_lut[256];
 
 uint16_t rectangular_2_magnitude(int16_t i, int16_t q);
-void rectangular_2_polar(int16_t i, int16_t q, uint16_t *mag, int16_t *phase);
 void initialise_luts();
 
+//approximate 1/denominator (to within 0.2%) as reciprocal/2^shift, avoids a
+//division for each bin or sample
+inline uint32_t reciprocal(uint32_t denominator, uint8_t &shift)
+{
+    //shift the leading one to bit 31, the next 8 bits index the table
+    const uint8_t leading_zeros = __builtin_clz(denominator);
+    shift = 47 - leading_zeros;
+    return reciprocal_lut[(denominator << leading_zeros) >> 23 & 0xff];
+}
+
 #endif
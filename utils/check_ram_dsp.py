@@ -0,0 +1,105 @@
+#!/usr/bin/env python
+#
+# List the flash resident symbols that can be reached from the core 1
+# streaming path. When built with PICORX_RAM_DSP core 1 keeps running while
+# core 0 writes to flash, anything it touches in flash will crash it.
+#
+# usage: check_ram_dsp.py <objdump> <elf> [--strict]
+#
+# Starting from the roots, the disassembly of each function is searched for
+# calls/branches to other symbols and for literal pool words that point at
+# other symbols. Functions in RAM are followed, anything in flash is reported
+# as "caller -> symbol".
+
+import re
+import subprocess
+import sys
+
+#dma_handler is registered and enabled on core 1 in rx::run, so it keeps
+#running while flash is written. usb_callback is left out, it runs on core 0
+#and USB is paused while flash is written.
+roots = ["rx::stream()", "rx::dma_handler()"]
+sections = [".text", ".data", ".scratch_x", ".scratch_y"]
+flash_start = 0x10000000
+flash_end = 0x20000000
+
+def in_flash(address):
+  return flash_start <= address < flash_end
+
+def read_symbols(objdump, elf):
+  symbols = {}
+  output = subprocess.run([objdump, "-t", "-C", elf], capture_output=True, text=True, check=True).stdout
+  for line in output.splitlines():
+    match = re.match(r"^([0-9a-f]+)\s+(\S*)\s+(\w)?\s*(\S+)\s+([0-9a-f]+)\s+(.*)$", line)
+    if not match: continue
+    address, flags, kind, section, size, name = match.groups()
+    if section in ("*ABS*", "*UND*") or not name: continue
+    symbols[name] = (int(address, 16) & ~1, int(size, 16), section)
+  return symbols
+
+def disassemble(objdump, elf):
+  functions = {}
+  current = None
+  #RAM functions live in data sections, so these are disassembled too
+  headers = subprocess.run([objdump, "-h", elf], capture_output=True, text=True, check=True).stdout
+  present = [s for s in sections if re.search(r"\s%s\s"%re.escape(s), headers)]
+  command = [objdump, "-D", "-C", "-z", elf]
+  for section in present: command += ["-j", section]
+  output = subprocess.run(command, capture_output=True, text=True, check=True).stdout
+  for line in output.splitlines():
+    match = re.match(r"^[0-9a-f]+ <(.*)>:$", line)
+    if match:
+      current = match.group(1)
+      functions[current] = []
+    elif current is not None:
+      functions[current].append(line)
+  return functions
+
+def references(lines, by_address):
+  found = set()
+  for line in lines:
+    #calls and branches annotated with a symbol name
+    for name in re.findall(r"<([^>+]+)(?:\+0x[0-9a-f]+)?>", line):
+      found.add(name)
+    #literal pool words
+    match = re.search(r"\.word\s+0x([0-9a-f]+)", line)
+    if match:
+      address = int(match.group(1), 16) & ~1
+      if address in by_address: found.add(by_address[address])
+  return found
+
+def main():
+  if len(sys.argv) < 3:
+    print("usage: check_ram_dsp.py <objdump> <elf> [--strict]")
+    return 1
+  objdump, elf = sys.argv[1:3]
+  strict = "--strict" in sys.argv
+
+  symbols = read_symbols(objdump, elf)
+  functions = disassemble(objdump, elf)
+  by_address = {}
+  for name, (address, size, section) in symbols.items():
+    if size: by_address.setdefault(address, name)
+
+  reported = set()
+  visited = set()
+  pending = [root for root in roots if root in functions]
+  while pending:
+    caller = pending.pop()
+    if caller in visited: continue
+    visited.add(caller)
+    for name in references(functions.get(caller, []), by_address):
+      if name not in symbols: continue
+      address, size, section = symbols[name]
+      if in_flash(address):
+        reported.add("%s -> %s"%(caller, name))
+      elif name in functions:
+        pending.append(name)
+
+  for line in sorted(reported):
+    print("check_ram_dsp: %s is in flash"%line)
+  print("check_ram_dsp: %u functions checked, %u flash references"%(len(visited), len(reported)))
+  return 1 if strict and reported else 0
+
+if __name__ == "__main__":
+  sys.exit(main())
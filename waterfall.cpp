@@ -324,18 +324,23 @@ void waterfall::update_spectrum(rx &receiver, s_settings &ui_settings, rx_settin
 
     static float last_filtered_power = 0;
     static uint8_t last_squelch = 255;
-    if(abs(filtered_power - last_filtered_power) > 1 || settings.squelch_threshold != last_squelch|| refresh)
+    static uint8_t last_squelch_type = 255;
+    if(abs(filtered_power - last_filtered_power) > 1 || settings.squelch_threshold != last_squelch || settings.squelch_type != last_squelch_type || refresh)
     {
       last_filtered_power = filtered_power;
       last_squelch = settings.squelch_threshold;
+      last_squelch_type = settings.squelch_type;
       uint16_t power_px = dBm_to_px(filtered_power, smeter_height+6);
       uint16_t squelch_px = dBm_to_px(S_to_dBm(settings.squelch_threshold), smeter_height);
 
       uint16_t colour=heatmap(dBm_to_px(filtered_power, 255));
       display->fillRect(smeter_x+15, smeter_y+4+smeter_height-power_px, power_px, smeter_bar_width, colour);
       display->fillRect(smeter_x+15, smeter_y+1,    smeter_height-power_px, smeter_bar_width, COLOUR_BLACK);
-      display->fillRect(smeter_x+15, smeter_y+0+smeter_height-squelch_px, 3, smeter_bar_width, COLOUR_RED);
-      display->fillRect(smeter_x+15, smeter_y+1+smeter_height-squelch_px, 1, smeter_bar_width, COLOUR_WHITE);
+      if(settings.squelch_type == squelch_signal_strength)
+      {
+        display->fillRect(smeter_x+15, smeter_y+0+smeter_height-squelch_px, 3, smeter_bar_width, COLOUR_RED);
+        display->fillRect(smeter_x+15, smeter_y+1+smeter_height-squelch_px, 1, smeter_bar_width, COLOUR_WHITE);
+      }
 
       char buffer[9];
       snprintf(buffer, 9, "%4.0fdBm", filtered_power);
@@ -436,6 +441,9 @@ void waterfall::update_spectrum(rx &receiver, s_settings &ui_settings, rx_settin
     {
       tick_spacing = 256*zoom*5/30; //place ticks at 5kHz steps
     }
+    //pass band edges, each column is 30kHz/(256*zoom)
+    const int16_t low_edge_col = (int32_t)status.filter_config.low_edge_Hz*256*zoom/30000;
+    const int16_t high_edge_col = (int32_t)status.filter_config.high_edge_Hz*256*zoom/30000;
     for(uint16_t scope_row = 0; scope_row < scope_height; ++scope_row)
     {
        uint16_t hline[num_cols];
@@ -454,9 +462,7 @@ void waterfall::update_spectrum(rx &receiver, s_settings &ui_settings, rx_settin
          uint8_t data_point = data_points[scope_col];//(scope_height * (uint16_t)waterfall_buffer[top_row][scope_col])/270;
 
          const int16_t fbin = scope_col-128;
-         const bool is_usb_col = (fbin > (status.filter_config.start_bin * zoom)) && (fbin < (status.filter_config.stop_bin * zoom)) && status.filter_config.upper_sideband;
-         const bool is_lsb_col = (-fbin > (status.filter_config.start_bin * zoom)) && (-fbin < (status.filter_config.stop_bin * zoom)) && status.filter_config.lower_sideband;
-         const bool is_passband = is_usb_col || is_lsb_col;
+         const bool is_passband = (fbin > low_edge_col) && (fbin < high_edge_col);
          const bool col_is_tick = (fbin%tick_spacing == 0) && fbin;
  
          if(scope_row < data_point)
@@ -485,9 +491,7 @@ void waterfall::update_spectrum(rx &receiver, s_settings &ui_settings, rx_settin
        for(uint16_t scope_col=0; scope_col<num_cols; ++scope_col)
        {
          const int16_t fbin = scope_col-128;
-         const bool is_usb_col = (fbin > (status.filter_config.start_bin * zoom)) && (fbin < (status.filter_config.stop_bin * zoom)) && status.filter_config.upper_sideband;
-         const bool is_lsb_col = (-fbin > (status.filter_config.start_bin * zoom)) && (-fbin < (status.filter_config.stop_bin * zoom)) && status.filter_config.lower_sideband;
-         const bool is_passband = is_usb_col || is_lsb_col;
+         const bool is_passband = (fbin > low_edge_col) && (fbin < high_edge_col);
  
          uint8_t heat = waterfall_buffer[row_address][scope_col];
          uint16_t colour=heatmap(heat, is_passband, fbin==0);
@@ -533,7 +537,6 @@ void waterfall::update_spectrum(rx &receiver, s_settings &ui_settings, rx_settin
 #define STRETCH true
 void waterfall::decode_sstv(rx &receiver)
 {
-  int16_t i, q;
   static uint16_t last_pixel_y=0;
   static uint8_t line_rgb[320][4];
   static c_sstv_decoder sstv_decoder(15000);
@@ -554,12 +557,20 @@ void waterfall::decode_sstv(rx &receiver)
 
   static uint32_t start_time = 0;
   uint32_t duration = time_us_32() - start_time;
-  printf("buffer level: %lu time: %lu\n", receiver.get_iq_buffer_level(), duration);
+  printf("buffer level: %lu high water: %lu overflows: %lu time: %lu\n",
+      receiver.get_iq_buffer_level(), receiver.get_iq_buffer_high_water_mark(),
+      receiver.get_iq_buffer_overflows(), duration);
   start_time = time_us_32();
   #endif
 
-  while(receiver.get_raw_data(i, q))
+  const s_iq_sample *samples;
+  uint32_t num_samples;
+  while((num_samples = receiver.peek_raw_data(samples)))
   {
+    for(uint32_t idx=0; idx<num_samples; idx++)
+    {
+      const int16_t i = samples[idx].i;
+      const int16_t q = samples[idx].q;
 
       samples_processed++;
       uint16_t pixel_y;
@@ -702,5 +713,7 @@ void waterfall::decode_sstv(rx &receiver)
           }
           
       }
-   }
+    }
+    receiver.consume_raw_data(num_samples);
+  }
 }